@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <ranges>
+#include <span>
+
+namespace linq
+{
+	template <typename T, size_t S, typename Allocator>
+	class Enumerable;
+
+	namespace pmr
+	{
+		// Sequence that allocates through a std::pmr::memory_resource
+		template <typename T>
+		using Enumerable = linq::Enumerable<T, 0, std::pmr::polymorphic_allocator<T>>;
+	}  // namespace pmr
+
+	// Monotonic memory for the intermediate sequences of a query. Buffers
+	// are carved out of a few large blocks and never freed one by one, so
+	// a chain like 'arena.View(data).Where(...).Select(...)' hardly calls
+	// the global allocator, and everything is released at once when the
+	// arena is destroyed or Release()d. Sequences allocated from an arena
+	// must not outlive it. Not thread-safe.
+	class Arena
+	{
+	public:
+		// 'blockSize' is the size of the first block taken from the heap
+		explicit Arena(size_t blockSize = 1 << 16) : _resource(blockSize) {}
+		// Starts out in 'buffer', e.g. on the stack, and only goes to the
+		// heap once that is full
+		explicit Arena(std::span<std::byte> buffer) : _resource(buffer.data(), buffer.size()) {}
+
+		Arena(const Arena&) = delete;
+		Arena& operator=(const Arena&) = delete;
+
+		std::pmr::memory_resource* Resource(void) { return &_resource; }
+
+		// Frees all memory taken from the heap and starts over, invalidating
+		// every sequence allocated from the arena
+		void Release(void) { _resource.release(); }
+
+		// Borrows 'range', all operators on the result allocate from the arena
+		template <std::ranges::contiguous_range Range>
+		auto View(const Range& range)
+		{
+			using T = std::ranges::range_value_t<Range>;
+
+			return pmr::Enumerable<T>::View(range, std::pmr::polymorphic_allocator<T>(&_resource));
+		}
+
+	private:
+		std::pmr::monotonic_buffer_resource _resource;
+	};
+}  // namespace linq
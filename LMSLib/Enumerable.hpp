@@ -7,30 +7,53 @@
 #include <limits>
 #include <map>
 #include <memory>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "Arena.hpp"
+#include "concepts.hpp"
+#include "FixedEnumerable.hpp"
+#include "hashing.hpp"
+#include "Incremental.hpp"
+#include "Join.hpp"
+#include "Lookup.hpp"
+#include "Ordering.hpp"
+#include "Parallel.hpp"
+#include "Query.hpp"
+#include "Simd.hpp"
+#include "Sketches.hpp"
+#include "SmallVector.hpp"
+#include "Sources.hpp"
+#include "Storage.hpp"
+#include "Summation.hpp"
+
 namespace linq
 {
 	constexpr size_t SIZE_T_MAX = std::numeric_limits<size_t>::max();
 
-	template <typename T>
-	concept Arithmetic = std::integral<T> or std::floating_point<T>;
-
-	template <typename T, typename U>
-	concept Same = std::is_same<T, U>::value;
-
-	template <typename T, size_t S = 0>
+	// Every operator allocates the buffer of its result, and the hash sets
+	// of the set operators, through a copy of 'Allocator' rebound to the
+	// type it needs, so all sequences of a query can share e.g. an Arena.
+	template <typename T, size_t S = 0, typename Allocator = std::allocator<T>>
 	class Enumerable
 	{
 	public:
+		using allocator_type = Allocator;
+
 		Enumerable(void) = delete;
-		Enumerable(const T*& array, const size_t& size)
+		Enumerable(const T*& array, const size_t& size, const Allocator& allocator = Allocator()) : _vec(allocator)
 		{
 			for (size_t i = 0; i < size; i++)
 				_vec.push_back(array[i]);
 		}
-		Enumerable(const std::array<T, S>& array) : _vec(std::begin(array), std::end(array)) {}
-		Enumerable(const std::vector<T>& vector) : _vec(vector) {}
+		Enumerable(const std::array<T, S>& array, const Allocator& allocator = Allocator())
+			: _vec(std::begin(array), std::end(array), allocator) {}
+		Enumerable(const std::vector<T, Allocator>& vector) : _vec(vector) {}
+		Enumerable(std::vector<T, Allocator>&& vector) : _vec(std::move(vector)) {}
 		template <typename T_Key, typename T_Value, typename = std::enable_if_t<std::is_same_v<T, std::map<T_Key, T_Value>>>>
 		Enumerable(const std::map<T_Key, T_Value>& map)
 		{
@@ -41,122 +64,235 @@ namespace linq
 			}
 		}
 
-		Enumerable(const Enumerable<T>& enumerable)
-			: _index(enumerable._index), _vec(enumerable._vec) {}
-		Enumerable(Enumerable<T>&& enumerable)
-			: _index(std::move(enumerable._index)), _vec(std::move(enumerable._vec)) {}
+		Enumerable(const Enumerable& enumerable) = default;
+		Enumerable(Enumerable&& enumerable) = default;
+		template <size_t S_Other>
+		Enumerable(const Enumerable<T, S_Other, Allocator>& enumerable)
+			: _index(enumerable._index), _vec(enumerable._vec), _view(enumerable._view), _borrowed(enumerable._borrowed) {}
+		template <size_t S_Other>
+		Enumerable(Enumerable<T, S_Other, Allocator>&& enumerable)
+			: _index(std::move(enumerable._index)), _vec(std::move(enumerable._vec)),
+			_view(enumerable._view), _borrowed(enumerable._borrowed) {}
 
 		~Enumerable(void) = default;
 
-		auto Aggregate(std::function<T(T, T)> func)
+		Enumerable& operator=(const Enumerable& enumerable) = default;
+		Enumerable& operator=(Enumerable&& enumerable) = default;
+
+		template <Accumulator<T> Function>
+		auto Aggregate(Function func) const
 		{
-			using std::begin, std::end;
-			std::vector<T> _rest(begin(_vec) + 1, end(_vec));
-			Enumerable tmp(_rest);
+			auto _elements = Elements();
+			auto _rest = View(_elements.subspan(1));
 
-			return tmp.Aggregate(_vec[0], func);
+			return _rest.Aggregate(_elements[0], func);
 		}
 
-		auto Aggregate(T seed, std::function<T(T, T)> func)
+		template <Accumulator<T> Function>
+		auto Aggregate(T seed, Function func) const
 		{
 			T _aggregate = seed;
 
-			foreach([&](T x) { _aggregate = func(_aggregate, x); });
+			foreach([&](const T& x) { _aggregate = func(_aggregate, x); });
 
 			return _aggregate;
 		}
 
-		auto All(std::function<bool(T)> predicate)
+		template <Predicate<T> Function>
+		auto All(Function predicate) const
 		{
-			if (_vec.size() == 0) return true;
+			return std::all_of(begin(), end(), predicate);
+		}
 
-			auto _returnValue = true;
+		auto Any(void) const { return Elements().size() != 0; }
 
-			foreach([&](T x) { if (!predicate(x)) _returnValue = false; });
+		template <Predicate<T> Function>
+		auto Any(Function predicate) const
+		{
+			return std::any_of(begin(), end(), predicate);
+		}
 
-			return _returnValue;
+		auto Append(T element) const&
+		{
+			auto _newVec = NewBuffer<T>();
+			auto _elements = Elements();
+
+			_newVec.reserve(_elements.size() + 1);
+			_newVec.insert(std::end(_newVec), std::begin(_elements), std::end(_elements));
+			_newVec.push_back(std::move(element));
+
+			return Sequence<T>(std::move(_newVec));
 		}
 
-		auto Any(void) { return _vec.size() != 0; }
+		// Temporaries hand their buffer on, so appending in a loop through
+		// 'e = std::move(e).Append(x)' is amortized O(1)
+		auto Append(T element) &&
+		{
+			auto _newVec = Release();
+
+			_newVec.push_back(std::move(element));
+
+			return Sequence<T>(std::move(_newVec));
+		}
 
-		auto Any(std::function<bool(T)> predicate)
+		// Estimated number of distinct elements in 2^precision bytes, see
+		// sketches::HyperLogLog
+		size_t ApproxCountDistinct(int precision = 12) const requires Hashable<T>
 		{
-			if (_vec.size() == 0) return false;
+			sketches::HyperLogLog<T> _sketch(precision);
 
-			auto _returnValue = false;
+			for (const auto& x : Elements())
+				_sketch.Add(x);
 
-			foreach([&](T x) { if (predicate(x)) _returnValue = true; });
+			return size_t(std::llround(_sketch.Estimate()));
+		}
 
-			return _returnValue;
+		// Estimated 'q'-quantile, from a sketch of about 3k elements, see
+		// sketches::QuantileSketch
+		T ApproxQuantile(double q, int k = 200) const requires Ordered<T>
+		{
+			InvalidOperationException("ApproxQuantile");
+			if (!(q >= 0 && q <= 1))
+				throw std::out_of_range("Enumerable<T>::ApproxQuantile() : 'q' is not in [0, 1]");
+
+			sketches::QuantileSketch<T> _sketch(k);
+
+			for (const auto& x : Elements())
+				_sketch.Add(x);
+
+			return _sketch.Quantile(q);
 		}
 
-		auto Append(T element)
+		// Returns a deferred-execution query that borrows the elements of this
+		// sequence, so it must not outlive it. Operators on the result are
+		// fused into a single pass and only run on materialization.
+		auto AsLazy(void) const& { return Query<stages::Source<T>>({ Elements().data(), Elements().size() }); }
+		// A temporary would be destroyed before the query runs
+		auto AsLazy(void) && = delete;
+
+		// Returns a view of this sequence whose operators run in chunks on a
+		// thread pool, ThreadPool::Default() unless another one is given.
+		auto AsParallel(void) const { return ParallelQuery<T>(Elements(), ThreadPool::Default()); }
+		auto AsParallel(ThreadPool& pool) const { return ParallelQuery<T>(Elements(), pool); }
+
+		// Accumulated in 64-bit integers or at least double, see
+		// summation::Wide, and 0 when there are no elements
+		template <std::floating_point T_Result = float>
+		T_Result Average(Summation summation = Summation::Naive) const requires Arithmetic<T>
 		{
-			std::vector<T> _newVec = _vec;
+			return summation::Mean<T_Result>(Sum<summation::Wide<T>>(summation), Elements().size());
+		}
 
-			_newVec.push_back(element);
+		template <typename T_Cast>
+		auto Cast(void) const
+		{
+			using std::begin, std::end;
+			auto _elements = Elements();
+			Buffer<T_Cast> _newVec(begin(_elements), end(_elements), Allocator_Of<T_Cast>(_vec.get_allocator()));
 
-			return Enumerable<T>(_newVec);
+			return Sequence<T_Cast>(std::move(_newVec));
 		}
 
-		float Average(void)
+		// Splits the elements into consecutive blocks of 'size', the last one
+		// possibly shorter. Blocks of a view are sub-views, those of an owning
+		// sequence copies, like Skip()/Take().
+		auto Chunk(int size) const
 		{
-			if (_vec.size() == 0)
-				return 0;
+			EnsurePositive(size, "Chunk");
 
-			T _sum = 0;
+			auto _count = Elements().size();
+			auto _newVec = NewBuffer<Sequence<T>>();
 
-			foreach([&](T x) {_sum += x; });
+			_newVec.reserve((_count + size - 1) / size);
+			for (size_t i = 0; i < _count; i += size)
+				_newVec.push_back(Slice(i, std::min<size_t>(size, _count - i)));
 
-			return _sum / static_cast<float>(_vec.size());
+			return Sequence<Sequence<T>>(std::move(_newVec));
 		}
 
-		template <typename T_Cast>
-		auto Cast(void)
+		template <size_t S_Second, typename Allocator_Second>
+		auto Concat(const Enumerable<T, S_Second, Allocator_Second>& second) const&
 		{
 			using std::begin, std::end;
-			std::vector<T_Cast> _newVec(begin(_vec), end(_vec));
+			auto _newVec = NewBuffer<T>();
+			auto _first = Elements();
+			auto _second = second.Elements();
+
+			_newVec.reserve(_first.size() + _second.size());
+			_newVec.insert(end(_newVec), begin(_first), end(_first));
+			_newVec.insert(end(_newVec), begin(_second), end(_second));
 
-			return Enumerable<T_Cast>(_newVec);
+			return Sequence<T>(std::move(_newVec));
 		}
 
-		template <size_t S_Second>
-		auto Concat(Enumerable<T, S_Second> second)
+		template <size_t S_Second, typename Allocator_Second>
+		auto Concat(const Enumerable<T, S_Second, Allocator_Second>& second) &&
 		{
 			using std::begin, std::end;
-			auto _firstVec = _vec;
-			auto _secondVec = second._vec;
+			auto _newVec = Release();
+			auto _second = second.Elements();
 
-			_firstVec.insert(end(_firstVec), begin(_secondVec), end(_secondVec));
+			_newVec.insert(end(_newVec), begin(_second), end(_second));
+
+			return Sequence<T>(std::move(_newVec));
+		}
 
-			return Enumerable<T>(_firstVec);
+		auto Contains(T item) const
+		{
+			return std::find(begin(), end(), item) != end();
 		}
 
-		auto Contains(T item)
+		auto Count(void) const { return int(Elements().size()); }
+
+		// Number of elements per key, in order of the first occurrence of each key
+		template <Selector<T> Function_Key>
+		auto CountBy(Function_Key keySelector) const
 		{
-			auto _contains = false;
+			using T_Key = std::remove_cvref_t<std::invoke_result_t<Function_Key, const T&>>;
 
-			foreach([&](T x) {if (x == item)
+			detail::KeyIndex<T_Key> _index;
+			auto _counts = NewBuffer<int>();
+
+			for (const auto& x : Elements())
 			{
-				_contains = true;
-				return;
-			} });
+				auto [_id, _inserted] = _index.Insert(keySelector(x));
+
+				if (_inserted)
+					_counts.push_back(0);
+				_counts[_id]++;
+			}
+
+			auto _newVec = NewBuffer<std::pair<T_Key, int>>();
+
+			_newVec.reserve(_counts.size());
+			for (size_t i = 0; i < _counts.size(); i++)
+				_newVec.emplace_back(_index.Keys()[i], _counts[i]);
 
-			return _contains;
+			return Sequence<std::pair<T_Key, int>>(std::move(_newVec));
 		}
 
-		auto Count(void) { return int(_vec.size()); }
+		auto Distinct(void) const requires Hashable<T> or Ordered<T>
+		{
+			if constexpr (Hashable<T>)
+				return Distinct(std::hash<T>(), std::equal_to<T>());
+			else
+				return Sequence<T>(DistinctOrdered(Elements()));
+		}
 
-		auto Distinct(void)
+		template <typename Hasher, typename Equality = std::equal_to<T>>
+		auto Distinct(Hasher hasher, Equality equality = Equality()) const
 		{
-			std::vector<T> _newVec;
+			auto _newVec = NewBuffer<T>();
+			auto _seen = detail::makePointerSet<T>(Elements().size(), hasher, equality, Allocator_Of<const T*>(_vec.get_allocator()));
 
-			foreach([&](T x) { if (!In(_newVec, x)) _newVec.push_back(x); });
+			for (const auto& x : Elements())
+				if (_seen.insert(&x).second)
+					_newVec.push_back(x);
 
-			return Enumerable<T>(_newVec);
+			return Sequence<T>(std::move(_newVec));
 		}
 
-		auto ElementAt(int index)
+		auto ElementAt(int index) const
 		{
 			if (index < 0)
 				throw std::out_of_range("Enumerable<T>::ElementAt() : 'index' is less than 0");
@@ -165,180 +301,354 @@ namespace linq
 					"Enumerable<T>::ElementAt() : 'index' is greater than or equal to the number of elements"
 				);
 
-			return _vec[index];
+			return Elements()[index];
 		}
 
-		static auto Empty(void)
+		static auto Empty(const Allocator& allocator = Allocator())
 		{
-			std::vector<T> _newVec;
-			return Enumerable<T>(_newVec);
+			Buffer<T> _newVec(allocator);
+			return Sequence<T>(std::move(_newVec));
 		}
 
-		template <size_t T_Second>
-		auto Except(Enumerable<T, T_Second> second)
+		template <size_t S_Second, typename Allocator_Second>
+		auto Except(const Enumerable<T, S_Second, Allocator_Second>& second) const requires Hashable<T> or Ordered<T>
 		{
-			std::vector<T> _newVec;
-			auto _dist = Distinct();
+			if constexpr (Hashable<T>)
+				return Except(second, std::hash<T>(), std::equal_to<T>());
+			else
+			{
+				auto _newVec = NewBuffer<T>();
+				auto _sorted = SortedPointers(second.Elements());
 
-			_dist.foreach([&](T x) { if (!second.Contains(x)) _newVec.push_back(x); });
+				for (const auto& x : DistinctOrdered(Elements()))
+					if (!SortedContains(_sorted, x))
+						_newVec.push_back(x);
 
-			return Enumerable<T>(_newVec);
+				return Sequence<T>(std::move(_newVec));
+			}
 		}
 
-		auto First(void)
+		template <size_t S_Second, typename Allocator_Second, typename Hasher, typename Equality = std::equal_to<T>>
+		auto Except(const Enumerable<T, S_Second, Allocator_Second>& second, Hasher hasher, Equality equality = Equality()) const
+		{
+			auto _newVec = NewBuffer<T>();
+			auto _seen = detail::makePointerSet<T>(Elements().size() + second.Elements().size(), hasher, equality,
+				Allocator_Of<const T*>(_vec.get_allocator()));
+
+			for (const auto& x : second.Elements())
+				_seen.insert(&x);
+			for (const auto& x : Elements())
+				if (_seen.insert(&x).second)
+					_newVec.push_back(x);
+
+			return Sequence<T>(std::move(_newVec));
+		}
+
+		auto First(void) const
 		{
 			InvalidOperationException(__func__);
-			return _vec.front();
+			return Elements().front();
 		}
 
-		auto First(std::function<bool(T)> predicate)
+		template <Predicate<T> Function>
+		auto First(Function predicate) const
 		{
-			auto _filtered = Where(predicate);
-			return _filtered.First();
+			for (const auto& x : Elements())
+				if (predicate(x))
+					return x;
+
+			throw std::runtime_error(
+				"Enumerable<T>::First() : No element satisfies the condition in 'predicate'"
+			);
 		}
 
-		template <typename Func_Key, typename Func_Element, typename Func_Result>
-		auto GroupBy(Func_Key keySelector, Func_Element elementSelector, Func_Result resultSelector)
+		// Groups the elements by key, see Lookup
+		template <Selector<T> Function_Key>
+		auto GroupBy(Function_Key keySelector) const { return ToLookup(keySelector); }
+
+		// Projects every group to resultSelector(key, elements), where the
+		// elements are elementSelector applied to the members of the group.
+		// The elements are a view that is only valid during the call.
+		template <Selector<T> Function_Key, Selector<T> Function_Element, typename Function_Result>
+		auto GroupBy(Function_Key keySelector, Function_Element elementSelector, Function_Result resultSelector) const
 		{
-			using T_Func_Element = typename std::invoke_result<Func_Element>::type;
-			using T_Out = typename std::invoke_result<Func_Result, T_Func_Element, Enumerable<T>>::type;
+			return ToLookup(keySelector, elementSelector).Select(resultSelector);
+		}
 
-			std::vector<T> _emptyVec;
-			std::vector<T_Out> _newVec;
-			std::map<T_Func_Element, Enumerable> _map;
+		// Calls resultSelector(x, matches) for every element x with all the
+		// elements of 'inner' whose key equals that of x, through a hash table
+		// on 'inner'. The matches are a view that is only valid during the call.
+		template <typename T_Inner, size_t S_Inner, typename Allocator_Inner, Selector<T> Function_OuterKey, Selector<T_Inner> Function_InnerKey, typename Function_Result>
+		auto GroupJoin(const Enumerable<T_Inner, S_Inner, Allocator_Inner>& inner, Function_OuterKey outerKeySelector,
+			Function_InnerKey innerKeySelector, Function_Result resultSelector) const
+		{
+			using T_Key = std::remove_cvref_t<std::invoke_result_t<Function_OuterKey, const T&>>;
+			using T_Out = std::remove_cvref_t<std::invoke_result_t<Function_Result, const T&, Enumerable<T_Inner>>>;
 
-			auto _select = Select(keySelector);
+			auto _lookup = Lookup<T_Key, T_Inner>::From(inner.Elements(), innerKeySelector, [](const T_Inner& x) -> const T_Inner& { return x; });
+			auto _newVec = NewBuffer<T_Out>();
 
-			_select.foreach([&](T x)
+			_newVec.reserve(Elements().size());
+			for (const auto& x : Elements())
+				_newVec.push_back(resultSelector(x, _lookup[outerKeySelector(x)]));
+
+			return Sequence<T_Out>(std::move(_newVec));
+		}
+
+		template <size_t S_Second, typename Allocator_Second>
+		auto Intersect(const Enumerable<T, S_Second, Allocator_Second>& second) const requires Hashable<T> or Ordered<T>
+		{
+			if constexpr (Hashable<T>)
+				return Intersect(second, std::hash<T>(), std::equal_to<T>());
+			else
 			{
-				auto [_iterator, _success] = _map.insert({ elementSelector, Enumerable(_emptyVec) });
-				_iterator->second.Append(x);
-			});
+				auto _newVec = NewBuffer<T>();
+				auto _sorted = SortedPointers(second.Elements());
+
+				for (const auto& x : DistinctOrdered(Elements()))
+					if (SortedContains(_sorted, x))
+						_newVec.push_back(x);
+
+				return Sequence<T>(std::move(_newVec));
+			}
+		}
 
-			for (const auto& [_key, _value] : _map)
-				_newVec.push_back(resultSelector(_key, _value));
+		template <size_t S_Second, typename Allocator_Second, typename Hasher, typename Equality = std::equal_to<T>>
+		auto Intersect(const Enumerable<T, S_Second, Allocator_Second>& second, Hasher hasher, Equality equality = Equality()) const
+		{
+			auto _newVec = NewBuffer<T>();
+			auto _remaining = detail::makePointerSet<T>(second.Elements().size(), hasher, equality,
+				Allocator_Of<const T*>(_vec.get_allocator()));
+
+			for (const auto& x : second.Elements())
+				_remaining.insert(&x);
+			for (const auto& x : Elements())
+				if (_remaining.erase(&x) != 0)
+					_newVec.push_back(x);
 
-			return Enumerable<T_Out>(_newVec);
+			return Sequence<T>(std::move(_newVec));
 		}
 
-		template <size_t S_Second>
-		auto Intersect(Enumerable<T, S_Second> second)
+		// Pairs up the elements of both sequences whose keys are equal, in the
+		// order of this sequence and then that of 'inner', like nested loops
+		// would but in O(n + m): a hash table is built on the smaller sequence
+		// and probed with every element of the other one. Each key selector
+		// runs once per element.
+		template <typename T_Inner, size_t S_Inner, typename Allocator_Inner, Selector<T> Function_OuterKey, Selector<T_Inner> Function_InnerKey, typename Function_Result>
+		auto Join(const Enumerable<T_Inner, S_Inner, Allocator_Inner>& inner, Function_OuterKey outerKeySelector,
+			Function_InnerKey innerKeySelector, Function_Result resultSelector, JoinMode mode = JoinMode::Hash) const
 		{
-			std::vector<T> _newVec;
+			using T_Key = std::remove_cvref_t<std::invoke_result_t<Function_OuterKey, const T&>>;
+			using T_Out = std::remove_cvref_t<std::invoke_result_t<Function_Result, const T&, const T_Inner&>>;
+
+			auto _outer = Elements();
+			auto _inner = inner.Elements();
+			auto _newVec = NewBuffer<T_Out>();
 
-			foreach([&](T x) { if (second.Contains(x)) _newVec.push_back(x); });
+			detail::join<T_Key>(
+				_outer.size(), [&](size_t i) { return outerKeySelector(_outer[i]); },
+				_inner.size(), [&](size_t i) { return innerKeySelector(_inner[i]); },
+				mode, [&](size_t o, size_t i) { _newVec.push_back(resultSelector(_outer[o], _inner[i])); }
+			);
 
-			return Enumerable<T>(_newVec);
+			return Sequence<T_Out>(std::move(_newVec));
 		}
 
-		auto Last(void)
+		auto Last(void) const
 		{
 			InvalidOperationException(__func__);
-			return _vec.back();
+			return Elements().back();
 		}
 
-		auto Last(std::function<bool(T)> predicate)
+		template <Predicate<T> Function>
+		auto Last(Function predicate) const
 		{
-			auto _filtered = Where(predicate);
-			return _filtered.Last();
+			auto _elements = Elements();
+
+			for (auto it = _elements.rbegin(); it != _elements.rend(); ++it)
+				if (predicate(*it))
+					return *it;
+
+			throw std::runtime_error(
+				"Enumerable<T>::Last() : No element satisfies the condition in 'predicate'"
+			);
 		}
 
-		auto Max(void)
+		auto Max(void) const
 		{
 			InvalidOperationException(__func__);
-			using std::begin, std::end;
-			return *std::max_element(begin(_vec), end(_vec));
+
+			if constexpr (simd::Vectorizable<T>)
+				return simd::MinMax(Elements()).second;
+			else
+				return *std::ranges::max_element(Elements());
 		}
 
-		auto Min(void)
+		auto Min(void) const
 		{
 			InvalidOperationException(__func__);
-			using std::begin, std::end;
-			return *std::min_element(begin(_vec), end(_vec));
+
+			if constexpr (simd::Vectorizable<T>)
+				return simd::MinMax(Elements()).first;
+			else
+				return *std::ranges::min_element(Elements());
 		}
 
-		auto Prepend(T element)
+		// Smallest and largest element in a single pass
+		auto MinMax(void) const
 		{
-			std::vector<T> _newVec = { element };
+			InvalidOperationException(__func__);
+
+			if constexpr (simd::Vectorizable<T>)
+				return simd::MinMax(Elements());
+			else
+			{
+				auto [_min, _max] = std::ranges::minmax_element(Elements());
+				return std::pair<T, T>(*_min, *_max);
+			}
+		}
+
+		// Sorts the elements by key once a terminal operation of the result
+		// runs, see OrderedEnumerable
+		template <Selector<T> Function>
+		auto OrderBy(Function keySelector) const& { return Order<false>(keySelector); }
+
+		template <Selector<T> Function>
+		auto OrderBy(Function keySelector) && { return std::move(*this).template Order<false>(keySelector); }
 
-			foreach([&](T x) {_newVec.push_back(x); });
+		template <Selector<T> Function>
+		auto OrderByDescending(Function keySelector) const& { return Order<true>(keySelector); }
 
-			return Enumerable<T>(_newVec);
+		template <Selector<T> Function>
+		auto OrderByDescending(Function keySelector) && { return std::move(*this).template Order<true>(keySelector); }
+
+		auto Prepend(T element) const&
+		{
+			auto _newVec = NewBuffer<T>();
+			auto _elements = Elements();
+
+			_newVec.reserve(_elements.size() + 1);
+			_newVec.push_back(std::move(element));
+			_newVec.insert(std::end(_newVec), std::begin(_elements), std::end(_elements));
+
+			return Sequence<T>(std::move(_newVec));
 		}
 
-		static auto Range(int start, int count)
+		auto Prepend(T element) &&
 		{
-			if (count < 0)
-				throw std::out_of_range("Enumerable<T>::Range() : 'count' is less than 0");
-			if (long(start + count - 1) > INT_MAX)
-				throw std::out_of_range("Enumerable<T>::Range() : Range exeeds 'INT_MAX'");
+			auto _newVec = Release();
+
+			_newVec.insert(std::begin(_newVec), std::move(element));
+
+			return Sequence<T>(std::move(_newVec));
+		}
 
-			std::vector<int> _newVec;
+		// Materializes linq::Range(), the integers [start, start + count)
+		static auto Range(int start, int count) { return linq::Range(start, count).ToEnumerable(); }
 
-			for (int i = start; i <= count; i++)
-				_newVec.push_back(i);
+		// Materializes linq::Repeat()
+		static auto Repeat(T element, int count) { return linq::Repeat(std::move(element), count).ToEnumerable(); }
 
-			return Enumerable<int>(_newVec);
+		auto Reverse(void) const&
+		{
+			auto _elements = Elements();
+			return Sequence<T>(Buffer<T>(_elements.rbegin(), _elements.rend(), _vec.get_allocator()));
 		}
 
-		static auto Repeat(T element, int count)
+		auto Reverse(void) &&
 		{
-			if (count < 0)
-				throw std::out_of_range("Enumerable<T>::Repeat() : 'count' is less than 0");
+			auto _newVec = Release();
+
+			std::reverse(std::begin(_newVec), std::end(_newVec));
+
+			return Sequence<T>(std::move(_newVec));
+		}
+
+		// Largest element of every window of 'size' consecutive elements, see
+		// SlidingWindow(). Runs in O(n) whatever the window size.
+		auto RollingMax(int size) const requires Ordered<T> { return RollingExtreme<true>(size, "RollingMax"); }
+
+		// Smallest element of every window of 'size' consecutive elements
+		auto RollingMin(int size) const requires Ordered<T> { return RollingExtreme<false>(size, "RollingMin"); }
+
+		// Sum of every window of 'size' consecutive elements, each one derived
+		// from the previous by adding the element that enters and subtracting
+		// the one that leaves. Floating point sums can drift from summing
+		// every window on its own by the rounding errors of those steps.
+		auto RollingSum(int size) const requires Arithmetic<T>
+		{
+			EnsurePositive(size, "RollingSum");
+
+			auto _elements = Elements();
+			auto _window = size_t(size);
+			auto _newVec = NewBuffer<T>();
+
+			if (_window > _elements.size())
+				return Sequence<T>(std::move(_newVec));
+
+			T _sum = T();
 
-			std::vector<T> _newVec;
+			for (size_t i = 0; i < _window; i++)
+				_sum += _elements[i];
 
-			for (int i = 0; i < count; i++)
-				_newVec.push_back(element);
+			_newVec.reserve(_elements.size() - _window + 1);
+			_newVec.push_back(_sum);
+			for (size_t i = _window; i < _elements.size(); i++)
+			{
+				_sum += _elements[i];
+				_sum -= _elements[i - _window];
+				_newVec.push_back(_sum);
+			}
 
-			return Enumerable<T>(_newVec);
+			return Sequence<T>(std::move(_newVec));
 		}
 
-		auto Reverse(void)
+		template <Selector<T> Function>
+		auto Select(Function selector) const&
 		{
-			using std::begin, std::end;
-			std::vector<T> _newVec;
+			using T_Out = std::remove_cvref_t<typename std::invoke_result<Function, T>::type>;
 
-			foreach([&](T x) {_newVec.insert(begin(_newVec), x); });
+			auto _newVec = NewBuffer<T_Out>();
 
-			return Enumerable<T>(_newVec);
+			_newVec.reserve(Elements().size());
+			for (const auto& x : Elements())
+				_newVec.push_back(selector(x));
+
+			return Sequence<T_Out>(std::move(_newVec));
 		}
 
-		template<typename T_Out>
-		auto Select(std::function<T_Out(T)> selector)
+		// Projections that keep the element type are applied in place
+		template <Selector<T> Function>
+		auto Select(Function selector) &&
 		{
-			// using T_Out = typename std::invoke_result<Function, T>::type;
+			using T_Out = std::remove_cvref_t<typename std::invoke_result<Function, T>::type>;
 
-			std::vector<T_Out> _newVec;
+			if constexpr (std::is_same_v<T_Out, T>)
+			{
+				auto _newVec = Release();
 
-			foreach([&](T x) { _newVec.push_back(selector(x)); });
+				for (auto& x : _newVec)
+					x = selector(std::as_const(x));
 
-			return Enumerable<T_Out>(_newVec);
+				return Sequence<T>(std::move(_newVec));
+			}
+			else
+				return std::as_const(*this).Select(selector);
 		}
 
-		template <size_t S_Second>
-		auto SequenceEqual(Enumerable<T, S_Second> second)
+		template <size_t S_Second, typename Allocator_Second>
+		auto SequenceEqual(const Enumerable<T, S_Second, Allocator_Second>& second) const
 		{
-			auto _equal = true;
 			auto _i = 0;
+			auto _second = second.Elements();
 
-			if (Count() != second.Count())
+			if (Elements().size() != _second.size())
 				return false;
 
-			foreach([&](T x)
-			{
-				if (x != second.ElementAt(_i))
-				{
-					_equal = false;
-					return;
-				}
-				_i++;
-			});
-
-			return _equal;
+			return foreachWhile([&](const T& x) { return x == _second[_i++]; });
 		}
 
-		auto Single(void)
+		auto Single(void) const
 		{
 			if (Count() != 1)
 				throw std::runtime_error(
@@ -348,61 +658,57 @@ namespace linq
 			return First();
 		}
 
-		template <typename Function>
-		auto Single(Function predicate)
+		template <Predicate<T> Function>
+		auto Single(Function predicate) const
 		{
 			InvalidOperationException(__func__);
 
-			auto _single = Select([](T x) {return x; }).Where(predicate);
+			const T* _single = nullptr;
+
+			for (const auto& x : Elements())
+			{
+				if (!predicate(x))
+					continue;
+				if (_single != nullptr)
+					throw std::runtime_error(
+						"Enumerable<T>::Single() : More than one element satisfies the condition in 'predicate'"
+					);
+				_single = &x;
+			}
 
-			if (_single.Count() == 0)
+			if (_single == nullptr)
 				throw std::runtime_error(
 					"Enumerable<T>::Single() : No element satisfies the condition in 'predicate'"
 				);
-			if (_single.Count() > 1)
-				throw std::runtime_error(
-					"Enumerable<T>::Single() : More than one element satisfies the condition in 'predicate'"
-				);
 
-			return _single.First();
+			return *_single;
 		}
 
-		auto Skip(int count)
+		auto Skip(int count) const
 		{
-			auto _i = 0;
-			std::vector<T> _newVec;
-
 			if (count <= 0)
-				return Enumerable<T>(_vec);
+				return Slice(0, Count());
 			if (count > Count())
-				return Enumerable<T>(_newVec);
-
-			foreach([&](T x)
-			{
-				if (_i >= count)
-					_newVec.push_back(x);
-				_i++;
-			});
+				return Slice(0, 0);
 
-			return Enumerable<T>(_newVec);
+			return Slice(count, Count() - count);
 		}
 
-		auto SkipLast(int count)
+		auto SkipLast(int count) const
 		{
-			std::vector<T> _newVec;
-
 			if (count < 0)
-				return Enumerable<T>(_vec);
+				return Slice(0, Count());
 
 			return Take(Count() - count);
 		}
 
-		auto SkipWhile(std::function<bool(T)> predicate)
+		template <Predicate<T> Function>
+		auto SkipWhile(Function predicate) const
 		{
 			auto _skip = true;
-			std::vector<T> _newVec;
+			auto _newVec = NewBuffer<T>();
 
-			foreach([&](T x)
+			foreach([&](const T& x)
 			{
 				if (_skip)
 					_skip = predicate(x);
@@ -410,16 +716,17 @@ namespace linq
 					_newVec.push_back(x);
 			});
 
-			return Enumerable<T>(_newVec);
+			return Sequence<T>(std::move(_newVec));
 		}
 
-		auto SkipWhile(std::function<bool(T, int)> predicate)
+		template <IndexedPredicate<T> Function>
+		auto SkipWhile(Function predicate) const
 		{
 			auto _skip = true;
 			auto _i = 0;
-			std::vector<T> _newVec;
+			auto _newVec = NewBuffer<T>();
 
-			foreach([&](T x)
+			foreach([&](const T& x)
 			{
 				if (_skip)
 					_skip = predicate(x, _i);
@@ -428,62 +735,75 @@ namespace linq
 				_i++;
 			});
 
-			return Enumerable<T>(_newVec);
+			return Sequence<T>(std::move(_newVec));
 		}
 
-		auto Sum() requires Arithmetic<T>
+		// Every run of 'size' consecutive elements, one starting at each
+		// element that has enough after it; none when there are fewer than
+		// 'size' elements. Windows of a view are sub-views, those of an owning
+		// sequence copies, so call View() first to avoid O(n * size) copying.
+		auto SlidingWindow(int size) const
 		{
-			T _sum = T();
+			EnsurePositive(size, "SlidingWindow");
 
-			foreach([&](T x) {_sum += x; });
+			auto _count = Elements().size();
+			auto _window = size_t(size);
+			auto _newVec = NewBuffer<Sequence<T>>();
 
-			return _sum;
+			if (_window > _count)
+				return Sequence<Sequence<T>>(std::move(_newVec));
+
+			_newVec.reserve(_count - _window + 1);
+			for (size_t i = 0; i + _window <= _count; i++)
+				_newVec.push_back(Slice(i, _window));
+
+			return Sequence<Sequence<T>>(std::move(_newVec));
 		}
 
-		auto Take(int count)
+		// Accumulates in T unless a wider T_Sum is asked for, e.g.
+		// Sum<long long>() for ints that could overflow or Sum<double>() for
+		// floats. The summation only matters for floating point T_Sum.
+		template <Arithmetic T_Sum = T>
+		T_Sum Sum(Summation summation = Summation::Naive) const requires Arithmetic<T>
 		{
-			auto _i = 0;
-			std::vector<T> _newVec;
+			if constexpr (simd::Accumulable<T_Sum, T>)
+				return simd::Accumulate<T_Sum>(Elements(), summation);
+			else
+				return summation::Accumulate<T_Sum>(summation, [&](auto add) { foreach(add); });
+		}
 
-			if (count <= 0)
-				return Enumerable<T>(_newVec);
+		// Sum and number of elements from the same pass, e.g. for averages.
+		// The sum is in summation::Wide<T>, like the one Average() divides.
+		auto SumAndCount(void) const requires Arithmetic<T>
+		{
+			return std::pair<summation::Wide<T>, int>(Sum<summation::Wide<T>>(), Count());
+		}
 
-			foreach([&](T x)
-			{
-				if (_i >= count)
-					return;
-				_newVec.push_back(x);
-				_i++;
-			});
+		auto Take(int count) const
+		{
+			if (count <= 0)
+				return Slice(0, 0);
 
-			return Enumerable<T>(_newVec);
+			return Slice(0, std::min(count, Count()));
 		}
 
-		auto TakeLast(int count)
+		auto TakeLast(int count) const
 		{
-			auto _i = 0;
-			auto _start = Count() - count;
-			std::vector<T> _newVec;
-
 			if (count < 0)
-				return Enumerable<T>(_newVec);
+				return Slice(0, 0);
 
-			foreach([&](T x)
-			{
-				if (_i >= _start)
-					_newVec.push_back(x);
-				_i++;
-			});
+			auto _start = std::max(Count() - count, 0);
 
-			return Enumerable<T>(_newVec);
+			return Slice(_start, Count() - _start);
 		}
 
-		auto TakeWhile(std::function<bool(T)> predicate)
+		template <Predicate<T> Function>
+		auto TakeWhile(Function predicate) const
 		{
 			auto _take = true;
-			std::vector<T> _newVec;
+			auto _newVec = NewBuffer<T>();
 
-			foreach([&](T x)
+			foreach([&](const T& x)
 			{
 				if (_take)
 					_take = predicate(x);
@@ -491,16 +811,17 @@ namespace linq
 					_newVec.push_back(x);
 			});
 
-			return Enumerable<T>(_newVec);
+			return Sequence<T>(std::move(_newVec));
 		}
 
-		auto TakeWhile(std::function<bool(T, int)> predicate)
+		template <IndexedPredicate<T> Function>
+		auto TakeWhile(Function predicate) const
 		{
 			auto _take = true;
 			auto _i = 0;
-			std::vector<T> _newVec;
+			auto _newVec = NewBuffer<T>();
 
-			foreach([&](T x)
+			foreach([&](const T& x)
 			{
 				if (_take)
 					_take = predicate(x, _i);
@@ -509,68 +830,330 @@ namespace linq
 				_i++;
 			});
 
-			return Enumerable<T>(_newVec);
+			return Sequence<T>(std::move(_newVec));
+		}
+
+		// Maps each key to its element, throws std::invalid_argument on duplicate keys
+		template <Selector<T> Function_Key>
+		auto ToDictionary(Function_Key keySelector) const
+		{
+			return ToDictionary(keySelector, [](const T& x) -> const T& { return x; });
 		}
 
-		template <size_t S_Second>
-		auto Union(Enumerable<T, S_Second> second)
+		template <Selector<T> Function_Key, Selector<T> Function_Element>
+		auto ToDictionary(Function_Key keySelector, Function_Element elementSelector) const
 		{
-			std::vector<T> _newVec;
+			using T_Key = std::remove_cvref_t<std::invoke_result_t<Function_Key, const T&>>;
+			using T_Element = std::remove_cvref_t<std::invoke_result_t<Function_Element, const T&>>;
 
-			foreach([&](T x) { if (!In(_newVec, x)) _newVec.push_back(x); });
-			second.foreach([&](T x) { if (!In(_newVec, x)) _newVec.push_back(x); });
+			std::unordered_map<T_Key, T_Element> _map;
 
-			return Enumerable<T>(_newVec);
+			_map.reserve(Elements().size());
+			for (const auto& x : Elements())
+				if (!_map.try_emplace(keySelector(x), elementSelector(x)).second)
+					throw std::invalid_argument("Enumerable<T>::ToDictionary() : Two elements have the same key");
+
+			return _map;
 		}
 
-		template <typename Function>
-		auto Where(Function predicate)
+		// Groups the elements by key in a single pass, see Lookup
+		template <Selector<T> Function_Key>
+		auto ToLookup(Function_Key keySelector) const
+		{
+			return ToLookup(keySelector, [](const T& x) -> const T& { return x; });
+		}
+
+		template <Selector<T> Function_Key, Selector<T> Function_Element>
+		auto ToLookup(Function_Key keySelector, Function_Element elementSelector) const
+		{
+			using T_Key = std::remove_cvref_t<std::invoke_result_t<Function_Key, const T&>>;
+			using T_Element = std::remove_cvref_t<std::invoke_result_t<Function_Element, const T&>>;
+
+			return Lookup<T_Key, T_Element>::From(Elements(), keySelector, elementSelector);
+		}
+
+		// Writes the elements to a table file that MappedTable<T> maps back in
+		// place. Per-block minimum and maximum values are kept for every given
+		// member, and for the elements themselves when T is arithmetic.
+		template <detail::ColumnOf<T>... Members>
+		void ToFile(const std::string& path, Members... columns) const requires std::is_trivially_copyable_v<T>
+		{
+			std::vector<detail::ColumnWriter<T>> _columns;
+
+			if constexpr (detail::ColumnValue<T>)
+				_columns.push_back({ { 0, detail::columnType<T>() }, &detail::blockMinMax<T, T> });
+			(_columns.push_back({
+				{ detail::columnOffset(columns), detail::columnType<typename detail::MemberTraits<Members>::Field>() },
+				&detail::blockMinMax<T, typename detail::MemberTraits<Members>::Field>
+			}), ...);
+
+			detail::writeTable(path, Elements(), detail::TABLE_BLOCK_RECORDS, _columns);
+		}
+
+		// Copies the elements into a vector the caller owns, the explicit way to
+		// take ownership of the data behind a view.
+		auto ToVector(void) const
+		{
+			auto _elements = Elements();
+			return std::vector<T>(std::begin(_elements), std::end(_elements));
+		}
+
+		// The 'k' most frequent elements with their estimated counts, most
+		// frequent first, from 'capacity' counters, 10 per element unless
+		// given. Exact while there are no more distinct elements than
+		// counters, see sketches::HeavyHitters.
+		auto TopKFrequent(int k, int capacity = 0) const requires Hashable<T>
+		{
+			if (k <= 0)
+				throw std::out_of_range("Enumerable<T>::TopKFrequent() : 'k' is less than 1");
+
+			sketches::HeavyHitters<T> _sketch(capacity > 0 ? capacity : 10 * k);
+
+			for (const auto& x : Elements())
+				_sketch.Add(x);
+
+			auto _newVec = NewBuffer<sketches::Frequency<T>>();
+
+			for (auto& x : _sketch.Top(k))
+				_newVec.push_back(std::move(x));
+
+			return Sequence<sketches::Frequency<T>>(std::move(_newVec));
+		}
+
+		template <size_t S_Second, typename Allocator_Second>
+		auto Union(const Enumerable<T, S_Second, Allocator_Second>& second) const requires Hashable<T> or Ordered<T>
 		{
-			std::vector<T> _newVec;
+			if constexpr (Hashable<T>)
+				return Union(second, std::hash<T>(), std::equal_to<T>());
+			else
+			{
+				using std::begin, std::end;
+				auto _all = NewBuffer<T>();
+				auto _firstElements = Elements();
+				auto _secondElements = second.Elements();
+
+				_all.reserve(_firstElements.size() + _secondElements.size());
+				_all.insert(end(_all), begin(_firstElements), end(_firstElements));
+				_all.insert(end(_all), begin(_secondElements), end(_secondElements));
+
+				return Sequence<T>(DistinctOrdered(_all));
+			}
+		}
+
+		template <size_t S_Second, typename Allocator_Second, typename Hasher, typename Equality = std::equal_to<T>>
+		auto Union(const Enumerable<T, S_Second, Allocator_Second>& second, Hasher hasher, Equality equality = Equality()) const
+		{
+			auto _newVec = NewBuffer<T>();
+			auto _seen = detail::makePointerSet<T>(Elements().size() + second.Elements().size(), hasher, equality,
+				Allocator_Of<const T*>(_vec.get_allocator()));
+
+			for (const auto& x : Elements())
+				if (_seen.insert(&x).second)
+					_newVec.push_back(x);
+			for (const auto& x : second.Elements())
+				if (_seen.insert(&x).second)
+					_newVec.push_back(x);
+
+			return Sequence<T>(std::move(_newVec));
+		}
+
+		// Non-owning views: borrow the elements instead of copying them, so the
+		// viewed data has to outlive the view. Operators on a view return owning
+		// sequences, apart from Skip()/Take() and friends which return sub-views.
+		// The operators on a view allocate through 'allocator'.
+		static auto View(std::span<const T> span, const Allocator& allocator = Allocator()) { return Sequence<T>(span, allocator); }
+
+		template <std::contiguous_iterator Iterator>
+		static auto View(Iterator first, Iterator last, const Allocator& allocator = Allocator())
+		{
+			return View(std::span<const T>(std::to_address(first), static_cast<size_t>(last - first)), allocator);
+		}
+
+		template <std::ranges::contiguous_range Range>
+		static auto View(const Range& range, const Allocator& allocator = Allocator())
+		{
+			return View(std::span<const T>(std::ranges::data(range), std::ranges::size(range)), allocator);
+		}
+
+		template <Predicate<T> Function>
+		auto Where(Function predicate) const&
+		{
+			auto _newVec = NewBuffer<T>();
+
+			for (const auto& x : Elements())
+				if (predicate(x))
+					_newVec.push_back(x);
+
+			return Sequence<T>(std::move(_newVec));
+		}
+
+		// Filters the buffer of an expiring sequence in place. An expiring view
+		// has no buffer, copying only the elements that pass beats copying all.
+		template <Predicate<T> Function>
+		auto Where(Function predicate) &&
+		{
+			if (_borrowed)
+				return std::as_const(*this).Where(predicate);
+
+			auto _newVec = Release();
 
-			foreach([&](T x) { if (predicate(x)) _newVec.push_back(x); });
+			_newVec.erase(std::remove_if(std::begin(_newVec), std::end(_newVec), [&](const T& x) { return !predicate(x); }), std::end(_newVec));
 
-			return Enumerable<T>(_newVec);
+			return Sequence<T>(std::move(_newVec));
 		}
 
-		template <typename T_Second, size_t S_Second, typename Function>
-		auto Zip(Enumerable<T_Second, S_Second> second, Function resultSelector)
+		template <typename T_Second, size_t S_Second, typename Allocator_Second, typename Function>
+			requires std::invocable<Function, T, T_Second>
+		auto Zip(Enumerable<T_Second, S_Second, Allocator_Second> second, Function resultSelector) const
 		{
 			using T_Out = typename std::invoke_result<Function, T, T_Second>::type;
 
 			auto _i = 0;
 			auto _len = Count() < second.Count() ? Count() : second.Count();
-			std::vector<T_Out> _newVec;
+			auto _newVec = NewBuffer<T_Out>();
 
-			foreach([&](T x)
+			foreach([&](const T& x)
 			{
 				if (_i < _len)
-					_newVec.push_back(resultSelector(x, second._vec[_i]));
+					_newVec.push_back(resultSelector(x, second.Elements()[_i]));
 				_i++;
 			});
 
-			return Enumerable<T_Out>(_newVec);
+			return Sequence<T_Out>(std::move(_newVec));
 		}
 
+		// Iterators are plain pointers into the elements, so an Enumerable is
+		// a contiguous range that works in range-for, std::ranges and the
+		// parallel algorithms of <execution>, and any number of readers can
+		// iterate it at the same time
+		const T* begin(void) const { return Elements().data(); }
+		const T* end(void) const { return Elements().data() + Elements().size(); }
+
+		// Cursor kept for existing callers. It lives in the sequence, so it
+		// does not nest and must not be shared between threads.
+		[[deprecated("iterate with begin()/end() or range-for instead")]]
 		void Reset(void) { _index = SIZE_T_MAX; }
-		bool MoveNext(void) { return _vec.size() > ++_index; }
-		T Current(void) { return _vec[_index]; }
+		[[deprecated("iterate with begin()/end() or range-for instead")]]
+		bool MoveNext(void) { return Elements().size() > ++_index; }
+		[[deprecated("iterate with begin()/end() or range-for instead")]]
+		const T& Current(void) const { return Elements()[_index]; }
 
+		// Elements are passed by const reference, so they are only copied when
+		// 'func' takes them by value
 		template <typename Function>
-		void foreach(Function func)
+		void foreach(Function func) const
 		{
-			Reset();
-			while (MoveNext())
-				func(Current());
+			for (const auto& x : Elements())
+				func(x);
+		}
+
+		// Calls 'func' with consecutive std::span<const T> blocks of 'size'
+		// elements, the last one possibly shorter, straight over the elements
+		// without copying them, e.g. to feed vectorized kernels or writers.
+		template <std::invocable<std::span<const T>> Function>
+		void foreachBatch(int size, Function func) const
+		{
+			EnsurePositive(size, "foreachBatch");
+
+			auto _elements = Elements();
+
+			for (size_t i = 0; i < _elements.size(); i += size)
+				func(_elements.subspan(i, std::min<size_t>(size, _elements.size() - i)));
+		}
+
+		template <std::invocable<std::span<const T>> Function>
+		void foreachBatch(Function func) const { foreachBatch(BATCH_SIZE<T>, func); }
+
+		// Like foreach(), but stops as soon as 'func' returns false. Returns
+		// whether every element was visited.
+		template <Predicate<T> Function>
+		bool foreachWhile(Function func) const
+		{
+			for (const auto& x : Elements())
+				if (!func(x))
+					return false;
+
+			return true;
 		}
 
 	private:
+		template <typename U>
+		using Allocator_Of = typename std::allocator_traits<Allocator>::template rebind_alloc<U>;
+
+		// Results are built in place up to InlineCapacity<U> elements
+		template <typename U>
+		using Buffer = detail::SmallVector<U, InlineCapacity<U>::value, Allocator_Of<U>>;
+
+		// Operators return sequences of the same allocator, rebound
+		template <typename U>
+		using Sequence = Enumerable<U, 0, Allocator_Of<U>>;
+
+		// Position of the Reset()/MoveNext()/Current() cursor
 		size_t _index = SIZE_T_MAX;
-		std::vector<T> _vec;
+		// Empty in a view, but still carries the allocator
+		Buffer<T> _vec;
+		std::span<const T> _view;
+		bool _borrowed = false;
 
+		template <typename, size_t, typename>
 		friend class Enumerable;
 
-		void InvalidOperationException(std::string _mName)
+		explicit Enumerable(std::span<const T> view, const Allocator& allocator = Allocator())
+			: _vec(allocator), _view(view), _borrowed(true) {}
+		explicit Enumerable(Buffer<T>&& buffer) : _vec(std::move(buffer)) {}
+
+		// The elements of this sequence, whether owned or borrowed
+		std::span<const T> Elements(void) const { return _borrowed ? _view : std::span<const T>(_vec.data(), _vec.size()); }
+
+		template <typename U>
+		Buffer<U> NewBuffer(void) const { return Buffer<U>(Allocator_Of<U>(_vec.get_allocator())); }
+
+		// Hands out the buffer of an expiring sequence, or a copy of the
+		// elements when they are borrowed
+		Buffer<T> Release(void)
+		{
+			if (_borrowed)
+				return Buffer<T>(std::begin(_view), std::end(_view), _vec.get_allocator());
+
+			return std::move(_vec);
+		}
+
+		// Views stay views when sliced, owning sequences copy the slice
+		Sequence<T> Slice(size_t offset, size_t count) const
+		{
+			auto _slice = Elements().subspan(offset, count);
+
+			if (_borrowed)
+				return Sequence<T>(_slice, _vec.get_allocator());
+
+			return Sequence<T>(Buffer<T>(std::begin(_slice), std::end(_slice), _vec.get_allocator()));
+		}
+
+		template <bool Descending, typename Function>
+		auto Order(Function keySelector) const&
+		{
+			using T_Ordered = OrderedEnumerable<T, detail::OrderLevel<Function, Descending>>;
+
+			return T_Ordered(Elements(), std::make_tuple(detail::OrderLevel<Function, Descending>{ keySelector }));
+		}
+
+		// A temporary hands its buffer to the ordering, which would dangle otherwise
+		template <bool Descending, typename Function>
+		auto Order(Function keySelector) &&
+		{
+			using T_Ordered = OrderedEnumerable<T, detail::OrderLevel<Function, Descending>>;
+
+			auto _owned = Release();
+			auto _levels = std::make_tuple(detail::OrderLevel<Function, Descending>{ keySelector });
+
+			if constexpr (std::is_same_v<Allocator, std::allocator<T>>)
+				return T_Ordered(std::make_shared<const std::vector<T>>(std::move(_owned).Detach()), std::move(_levels));
+			else
+				return T_Ordered(std::make_shared<const std::vector<T>>(
+					std::make_move_iterator(std::begin(_owned)), std::make_move_iterator(std::end(_owned))), std::move(_levels));
+		}
+
+		void InvalidOperationException(std::string _mName) const
 		{
 			if (Count() == 0)
 				throw std::runtime_error(std::string(
@@ -578,9 +1161,107 @@ namespace linq
 				));
 		}
 
-		static inline bool In(std::vector<T> _v, T _x)
+		static void EnsurePositive(int size, const char* _mName)
+		{
+			if (size <= 0)
+				throw std::out_of_range(std::string("Enumerable<T>::") + _mName + "() : 'size' is less than 1");
+		}
+
+		// Keeps the indices of the elements that can still become the extreme
+		// of a later window in a monotonic deque: an element makes every
+		// earlier one that is not more extreme redundant. Every index enters
+		// and leaves the deque once, and it never holds more than 'size' of
+		// them, so it lives in a ring of that many slots.
+		template <bool Max>
+		auto RollingExtreme(int size, const char* _mName) const
+		{
+			EnsurePositive(size, _mName);
+
+			auto _elements = Elements();
+			auto _window = size_t(size);
+			auto _newVec = NewBuffer<T>();
+
+			if (_window > _elements.size())
+				return Sequence<T>(std::move(_newVec));
+
+			std::vector<size_t, Allocator_Of<size_t>> _ring(_window, 0, _vec.get_allocator());
+			size_t _front = 0, _count = 0;
+			auto _slot = [&](size_t offset) -> size_t&
+			{
+				auto _i = _front + offset;
+				return _ring[_i < _window ? _i : _i - _window];
+			};
+			auto _beats = [](const T& x, const T& y) { return Max ? y < x : x < y; };
+
+			_newVec.reserve(_elements.size() - _window + 1);
+			for (size_t i = 0; i < _elements.size(); i++)
+			{
+				if (_count != 0 && _slot(0) + _window <= i)
+				{
+					_front = _front + 1 < _window ? _front + 1 : 0;
+					_count--;
+				}
+				while (_count != 0 && !_beats(_elements[_slot(_count - 1)], _elements[i]))
+					_count--;
+				_slot(_count++) = i;
+
+				if (i + 1 >= _window)
+					_newVec.push_back(_elements[_slot(0)]);
+			}
+
+			return Sequence<T>(std::move(_newVec));
+		}
+
+		// Fallbacks for element types that are ordered but not hashable, two
+		// elements being equal when neither is less than the other.
+		auto SortedPointers(std::span<const T> _v) const
+		{
+			auto _sorted = NewBuffer<const T*>();
+
+			_sorted.reserve(_v.size());
+			for (const auto& x : _v)
+				_sorted.push_back(&x);
+			std::stable_sort(std::begin(_sorted), std::end(_sorted), [](const T* x, const T* y) { return *x < *y; });
+
+			return _sorted;
+		}
+
+		static bool SortedContains(const Buffer<const T*>& _sorted, const T& _x)
 		{
-			return std::find(std::begin(_v), std::end(_v), _x) != std::end(_v);
+			return std::binary_search(std::begin(_sorted), std::end(_sorted), &_x,
+				[](const T* x, const T* y) { return *x < *y; });
+		}
+
+		auto DistinctOrdered(std::span<const T> _v) const
+		{
+			auto _newVec = NewBuffer<T>();
+			std::vector<bool, Allocator_Of<bool>> _keep(_v.size(), false, _vec.get_allocator());
+			auto _sorted = SortedPointers(_v);
+
+			for (size_t i = 0; i < _sorted.size(); i++)
+				if (i == 0 || *_sorted[i - 1] < *_sorted[i])
+					_keep[_sorted[i] - _v.data()] = true;
+
+			for (size_t i = 0; i < _v.size(); i++)
+				if (_keep[i])
+					_newVec.push_back(_v[i]);
+
+			return _newVec;
 		}
 	};
+
+	// Borrows any range without copying it. Contiguous ranges become an
+	// Enumerable view, everything else a lazy Query over its iterators.
+	template <std::ranges::range Range>
+	auto View(const Range& range)
+	{
+		using T = std::ranges::range_value_t<Range>;
+
+		if constexpr (std::ranges::contiguous_range<Range>)
+			return Enumerable<T>::View(range);
+		else
+			return Query<stages::IteratorSource<std::ranges::iterator_t<const Range>>>(
+				{ std::ranges::begin(range), std::ranges::end(range) }
+			);
+	}
 }  // namespace linq
@@ -0,0 +1,237 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "concepts.hpp"
+#include "Simd.hpp"
+#include "Summation.hpp"
+
+namespace linq
+{
+	template <typename T, size_t S, typename Allocator>
+	class Enumerable;
+
+	// Sequence of at most N elements held in a std::array, for data whose
+	// size is known at compile time. Every operator is constexpr, so a
+	// query over a constant array can be evaluated by the compiler, e.g. to
+	// build a lookup table in a constexpr variable, and never allocates at
+	// run time either. Operators keep the capacity N and return a new
+	// sequence of the elements they produce; unlike Enumerable, OrderBy()
+	// sorts right away. T has to be default constructible.
+	template <typename T, size_t N>
+	class FixedEnumerable
+	{
+	public:
+		using value_type = T;
+
+		constexpr FixedEnumerable(void) = default;
+		constexpr FixedEnumerable(const std::array<T, N>& array) : _elements(array), _size(N) {}
+
+		template <Accumulator<T> Function>
+		constexpr auto Aggregate(T seed, Function func) const
+		{
+			for (const auto& x : *this)
+				seed = func(seed, x);
+
+			return seed;
+		}
+
+		template <Predicate<T> Function>
+		constexpr bool All(Function predicate) const { return std::all_of(begin(), end(), predicate); }
+
+		constexpr bool Any(void) const { return _size != 0; }
+
+		template <Predicate<T> Function>
+		constexpr bool Any(Function predicate) const { return std::any_of(begin(), end(), predicate); }
+
+		constexpr bool Contains(const T& item) const { return std::find(begin(), end(), item) != end(); }
+
+		constexpr int Count(void) const { return int(_size); }
+
+		// Equal elements are found by comparing every pair, O(n^2)
+		constexpr auto Distinct(void) const
+		{
+			FixedEnumerable _new;
+
+			for (const auto& x : *this)
+				if (!_new.Contains(x))
+					_new.Push(x);
+
+			return _new;
+		}
+
+		constexpr const T& ElementAt(int index) const
+		{
+			if (index < 0 || size_t(index) >= _size)
+				throw std::out_of_range("FixedEnumerable<T>::ElementAt() : 'index' is out of range");
+
+			return _elements[index];
+		}
+
+		constexpr const T& First(void) const { return ElementAt(0); }
+
+		constexpr const T& Last(void) const { return ElementAt(Count() - 1); }
+
+		constexpr T Max(void) const
+		{
+			EnsureNotEmpty("Max");
+			return *std::max_element(begin(), end());
+		}
+
+		constexpr T Min(void) const
+		{
+			EnsureNotEmpty("Min");
+			return *std::min_element(begin(), end());
+		}
+
+		// Stable sort by key, each key selector runs once per element
+		template <Selector<T> Function>
+		constexpr auto OrderBy(Function keySelector) const { return Order<false>(keySelector); }
+
+		template <Selector<T> Function>
+		constexpr auto OrderByDescending(Function keySelector) const { return Order<true>(keySelector); }
+
+		constexpr auto Reverse(void) const
+		{
+			FixedEnumerable _new;
+
+			for (size_t i = _size; i > 0; i--)
+				_new.Push(_elements[i - 1]);
+
+			return _new;
+		}
+
+		template <Selector<T> Function>
+		constexpr auto Select(Function selector) const
+		{
+			using T_Out = std::remove_cvref_t<std::invoke_result_t<Function, const T&>>;
+
+			FixedEnumerable<T_Out, N> _new;
+
+			for (const auto& x : *this)
+				_new.Push(selector(x));
+
+			return _new;
+		}
+
+		template <size_t M>
+		constexpr bool SequenceEqual(const FixedEnumerable<T, M>& second) const
+		{
+			return std::equal(begin(), end(), second.begin(), second.end());
+		}
+
+		constexpr auto Skip(int count) const { return Slice(std::clamp(count, 0, Count()), Count()); }
+
+		// Vectorized when evaluated at run time, see Enumerable<T>::Sum()
+		template <Arithmetic T_Sum = T>
+		constexpr T_Sum Sum(Summation summation = Summation::Naive) const requires Arithmetic<T>
+		{
+			if constexpr (simd::Accumulable<T_Sum, T>)
+				if (!std::is_constant_evaluated())
+					return simd::Accumulate<T_Sum>(std::span<const T>(begin(), end()), summation);
+
+			return summation::Accumulate<T_Sum>(summation, [&](auto add) { std::for_each(begin(), end(), add); });
+		}
+
+		constexpr auto Take(int count) const { return Slice(0, std::clamp(count, 0, Count())); }
+
+		// The elements in the first Count() slots, value-initialized after
+		constexpr std::array<T, N> ToArray(void) const
+		{
+			std::array<T, N> _array{};
+
+			std::copy(begin(), end(), _array.begin());
+
+			return _array;
+		}
+
+		// Copies the elements into a run time Enumerable
+		auto ToEnumerable(void) const { return Enumerable<T, 0, std::allocator<T>>(std::vector<T>(begin(), end())); }
+
+		template <Predicate<T> Function>
+		constexpr auto Where(Function predicate) const
+		{
+			FixedEnumerable _new;
+
+			for (const auto& x : *this)
+				if (predicate(x))
+					_new.Push(x);
+
+			return _new;
+		}
+
+		constexpr const T* begin(void) const { return _elements.data(); }
+		constexpr const T* end(void) const { return _elements.data() + _size; }
+
+	private:
+		std::array<T, N> _elements{};
+		size_t _size = 0;
+
+		template <typename, size_t>
+		friend class FixedEnumerable;
+
+		constexpr void Push(T element)
+		{
+			_elements[_size++] = std::move(element);
+		}
+
+		constexpr FixedEnumerable Slice(int first, int last) const
+		{
+			FixedEnumerable _new;
+
+			for (auto i = first; i < last; i++)
+				_new.Push(_elements[i]);
+
+			return _new;
+		}
+
+		// Sorts indices by the cached keys with the index as tiebreak, since
+		// std::stable_sort is not constexpr
+		template <bool Descending, typename Function>
+		constexpr auto Order(Function keySelector) const
+		{
+			using T_Key = std::remove_cvref_t<std::invoke_result_t<Function, const T&>>;
+
+			std::array<std::pair<T_Key, size_t>, N> _keys{};
+
+			for (size_t i = 0; i < _size; i++)
+				_keys[i] = { keySelector(_elements[i]), i };
+
+			std::sort(_keys.begin(), _keys.begin() + _size, [](const auto& x, const auto& y)
+			{
+				if (x.first < y.first)
+					return !Descending;
+				if (y.first < x.first)
+					return Descending;
+
+				return x.second < y.second;
+			});
+
+			FixedEnumerable _new;
+
+			for (size_t i = 0; i < _size; i++)
+				_new.Push(_elements[_keys[i].second]);
+
+			return _new;
+		}
+
+		constexpr void EnsureNotEmpty(const char* _mName) const
+		{
+			if (_size == 0)
+				throw std::runtime_error(std::string("FixedEnumerable<T>::") + _mName + "() : The source sequence is empty");
+		}
+	};
+
+	template <typename T, size_t N>
+	FixedEnumerable(const std::array<T, N>&) -> FixedEnumerable<T, N>;
+}  // namespace linq
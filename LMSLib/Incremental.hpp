@@ -0,0 +1,477 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <memory>
+#include <queue>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "concepts.hpp"
+#include "Summation.hpp"
+
+namespace linq
+{
+	template <typename T, size_t S, typename Allocator>
+	class Enumerable;
+
+	template <typename T>
+	class ObservableCollection;
+
+	namespace detail
+	{
+		// Told about every element added to or removed from an
+		// ObservableCollection, while the element is still in it
+		template <typename T>
+		struct Observer
+		{
+			virtual ~Observer(void) = default;
+
+			virtual void Added(std::span<const T> elements) = 0;
+			virtual void Removed(const T& element) = 0;
+		};
+
+		// Pipelines call sink(y) for each element y a source element turns
+		// into, which for Where() and Select() chains is at most one
+		struct IdentityPipeline
+		{
+			template <typename T, typename Sink>
+			void operator()(const T& x, Sink&& sink) const { sink(x); }
+		};
+
+		template <typename Previous, typename Function>
+		struct WherePipeline
+		{
+			Previous previous;
+			Function predicate;
+
+			template <typename T, typename Sink>
+			void operator()(const T& x, Sink&& sink) const
+			{
+				previous(x, [&](const auto& y)
+				{
+					if (predicate(y))
+						sink(y);
+				});
+			}
+		};
+
+		template <typename Previous, typename Function>
+		struct SelectPipeline
+		{
+			Previous previous;
+			Function selector;
+
+			template <typename T, typename Sink>
+			void operator()(const T& x, Sink&& sink) const
+			{
+				previous(x, [&](const auto& y) { sink(selector(y)); });
+			}
+		};
+
+		// Running aggregates. Each one is updated in O(1), or O(log n) for
+		// the extremes, per element added or removed.
+		template <typename U>
+		class CountState
+		{
+		public:
+			void Add(const U&) { _count++; }
+			void Remove(const U&) { _count--; }
+
+			int Value(void) const { return _count; }
+
+		private:
+			int _count = 0;
+		};
+
+		// Integer sums wrap, like Enumerable<T>::Sum()
+		template <typename U>
+		class SumState
+		{
+		public:
+			void Add(const U& x) { _sum = summation::add(_sum, x); }
+			void Remove(const U& x) { _sum = summation::subtract(_sum, x); }
+
+			U Value(void) const { return _sum; }
+
+		private:
+			U _sum = U();
+		};
+
+		// Summed in summation::Wide<U> and 0 when there are no elements, like
+		// Enumerable<T>::Average()
+		template <typename U>
+		class AverageState
+		{
+		public:
+			void Add(const U& x) { _sum.Add(x); _count.Add(x); }
+			void Remove(const U& x) { _sum.Remove(x); _count.Remove(x); }
+
+			float Value(void) const { return summation::Mean<float>(_sum.Value(), size_t(_count.Value())); }
+
+		private:
+			SumState<summation::Wide<U>> _sum;
+			CountState<U> _count;
+		};
+
+		// Binary heap of the elements with lazy deletion: removed elements go
+		// into a second heap and leave both once they surface at the top, so
+		// the top of the first heap is always a live element. Removed
+		// elements that never surface are kept until then.
+		template <typename U, bool Max>
+		class ExtremeState
+		{
+		public:
+			void Add(const U& x) { _heap.push(x); }
+
+			void Remove(const U& x)
+			{
+				_removed.push(x);
+
+				// Removed elements rank no higher than the top, so the top is
+				// removed exactly when it does not rank above the removed top
+				while (!_removed.empty() && !_heap.empty() && !Compare()(_removed.top(), _heap.top()))
+				{
+					_heap.pop();
+					_removed.pop();
+				}
+			}
+
+			const U& Value(void) const
+			{
+				if (_heap.empty())
+					throw std::runtime_error(std::string("Materialized<T>::") + (Max ? "Max" : "Min") + "() : The source sequence is empty");
+
+				return _heap.top();
+			}
+
+		private:
+			using Compare = std::conditional_t<Max, std::less<U>, std::greater<U>>;
+
+			std::priority_queue<U, std::vector<U>, Compare> _heap;
+			std::priority_queue<U, std::vector<U>, Compare> _removed;
+		};
+
+		// One running aggregate per key, over elementSelector() of the members
+		// of the group. Groups disappear with their last member.
+		template <typename U, typename T_Key, typename Function_Key, typename Function_Element, typename State>
+		class GroupState
+		{
+		public:
+			GroupState(Function_Key keySelector, Function_Element elementSelector)
+				: _keySelector(std::move(keySelector)), _elementSelector(std::move(elementSelector)) {}
+
+			void Add(const U& x)
+			{
+				auto& [_count, _state] = _groups[_keySelector(x)];
+
+				_count++;
+				_state.Add(_elementSelector(x));
+			}
+
+			void Remove(const U& x)
+			{
+				auto _group = _groups.find(_keySelector(x));
+
+				if (_group == _groups.end())
+					return;
+				if (--_group->second.first == 0)
+					_groups.erase(_group);
+				else
+					_group->second.second.Remove(_elementSelector(x));
+			}
+
+			decltype(auto) Value(const T_Key& key) const
+			{
+				auto _group = _groups.find(key);
+
+				if (_group == _groups.end())
+					throw std::out_of_range("Materialized<T>::Value() : There is no group for 'key'");
+
+				return _group->second.second.Value();
+			}
+
+			bool Contains(const T_Key& key) const { return _groups.contains(key); }
+
+			// Number of groups
+			int Count(void) const { return int(_groups.size()); }
+
+			// Calls func(key, value) for every group, in no particular order
+			template <typename Function>
+			void foreach(Function func) const
+			{
+				for (const auto& [_key, _group] : _groups)
+					func(_key, _group.second.Value());
+			}
+
+		private:
+			using Group = std::pair<int, State>;
+
+			Function_Key _keySelector;
+			Function_Element _elementSelector;
+			// Keys that cannot be hashed are kept in order instead
+			std::conditional_t<Hashable<T_Key>, std::unordered_map<T_Key, Group>, std::map<T_Key, Group>> _groups;
+		};
+
+		template <typename T_Source, typename Pipeline, typename State>
+		struct MaterializedNode : Observer<T_Source>
+		{
+			Pipeline pipeline;
+			State state;
+
+			MaterializedNode(Pipeline pipeline, State state) : pipeline(std::move(pipeline)), state(std::move(state)) {}
+
+			void Added(std::span<const T_Source> elements) override
+			{
+				for (const auto& x : elements)
+					pipeline(x, [&](const auto& y) { state.Add(y); });
+			}
+
+			void Removed(const T_Source& element) override
+			{
+				pipeline(element, [&](const auto& y) { state.Remove(y); });
+			}
+		};
+	}  // namespace detail
+
+	// Aggregates that IncrementalQuery<T>::GroupBy() keeps per group
+	namespace incremental
+	{
+		struct Count { template <typename U> using State = detail::CountState<U>; };
+		struct Sum { template <typename U> using State = detail::SumState<U>; };
+		struct Average { template <typename U> using State = detail::AverageState<U>; };
+		struct Min { template <typename U> using State = detail::ExtremeState<U, false>; };
+		struct Max { template <typename U> using State = detail::ExtremeState<U, true>; };
+	}  // namespace incremental
+
+	// Query result kept up to date as its ObservableCollection changes,
+	// created by the terminal operators of IncrementalQuery. Reading it is
+	// O(1); it stops updating when the collection is destroyed, and the
+	// collection forgets it once it is destroyed itself.
+	template <typename T_Source, typename Pipeline, typename State>
+	class Materialized
+	{
+	public:
+		// The current result; for GroupBy() that of the group of 'key'
+		template <typename... Args>
+		decltype(auto) Value(const Args&... args) const { return _node->state.Value(args...); }
+
+		// For GroupBy(): whether there is a group for 'key'
+		template <typename T_Key>
+		bool Contains(const T_Key& key) const { return _node->state.Contains(key); }
+
+		// For GroupBy(): the number of groups
+		int Count(void) const { return _node->state.Count(); }
+
+		// For GroupBy(): calls func(key, value) for every group
+		template <typename Function>
+		void foreach(Function func) const { _node->state.foreach(func); }
+
+	private:
+		std::shared_ptr<detail::MaterializedNode<T_Source, Pipeline, State>> _node;
+
+		template <typename, typename, typename>
+		friend class IncrementalQuery;
+
+		explicit Materialized(std::shared_ptr<detail::MaterializedNode<T_Source, Pipeline, State>> node) : _node(std::move(node)) {}
+	};
+
+	// Where()/Select() chain over an ObservableCollection, created by its
+	// Observe(). The terminal operators compute their result over the
+	// current elements once, then every element added to or removed from
+	// the collection flows through the chain into the result, so keeping it
+	// current costs O(delta) instead of a rescan per change. Removals run
+	// the chain again on the removed element, so predicates and selectors
+	// have to give the same result for the same element every time.
+	template <typename T_Source, typename T, typename Pipeline>
+	class IncrementalQuery
+	{
+	public:
+		using value_type = T;
+
+		template <Predicate<T> Function>
+		auto Where(Function predicate) const
+		{
+			using T_Pipeline = detail::WherePipeline<Pipeline, Function>;
+
+			return IncrementalQuery<T_Source, T, T_Pipeline>(_source, T_Pipeline{ _pipeline, std::move(predicate) });
+		}
+
+		template <Selector<T> Function>
+		auto Select(Function selector) const
+		{
+			using T_Out = std::remove_cvref_t<std::invoke_result_t<Function, const T&>>;
+			using T_Pipeline = detail::SelectPipeline<Pipeline, Function>;
+
+			return IncrementalQuery<T_Source, T_Out, T_Pipeline>(_source, T_Pipeline{ _pipeline, std::move(selector) });
+		}
+
+		auto Average(void) const requires Arithmetic<T> { return Materialize(detail::AverageState<T>()); }
+
+		auto Count(void) const { return Materialize(detail::CountState<T>()); }
+
+		auto Max(void) const requires Ordered<T> { return Materialize(detail::ExtremeState<T, true>()); }
+
+		auto Min(void) const requires Ordered<T> { return Materialize(detail::ExtremeState<T, false>()); }
+
+		auto Sum(void) const requires Arithmetic<T> { return Materialize(detail::SumState<T>()); }
+
+		// Table of one running aggregate per key, the number of elements
+		// unless another incremental:: aggregate is given
+		template <Selector<T> Function_Key, typename Aggregate = incremental::Count>
+		auto GroupBy(Function_Key keySelector, Aggregate aggregate = Aggregate()) const
+		{
+			return GroupBy(keySelector, [](const T& x) -> const T& { return x; }, aggregate);
+		}
+
+		// Table of the aggregate of elementSelector() over the members of
+		// each group, e.g. the total amount per customer
+		template <Selector<T> Function_Key, Selector<T> Function_Element, typename Aggregate>
+		auto GroupBy(Function_Key keySelector, Function_Element elementSelector, Aggregate) const
+		{
+			using T_Key = std::remove_cvref_t<std::invoke_result_t<Function_Key, const T&>>;
+			using T_Element = std::remove_cvref_t<std::invoke_result_t<Function_Element, const T&>>;
+			using T_State = detail::GroupState<T, T_Key, Function_Key, Function_Element, typename Aggregate::template State<T_Element>>;
+
+			return Materialize(T_State(std::move(keySelector), std::move(elementSelector)));
+		}
+
+	private:
+		ObservableCollection<T_Source>* _source;
+		Pipeline _pipeline;
+
+		template <typename>
+		friend class ObservableCollection;
+
+		template <typename, typename, typename>
+		friend class IncrementalQuery;
+
+		IncrementalQuery(ObservableCollection<T_Source>* source, Pipeline pipeline) : _source(source), _pipeline(std::move(pipeline)) {}
+
+		template <typename State>
+		auto Materialize(State state) const
+		{
+			auto _node = std::make_shared<detail::MaterializedNode<T_Source, Pipeline, State>>(_pipeline, std::move(state));
+
+			_node->Added(std::span<const T_Source>(_source->_elements));
+			_source->_observers.push_back(_node);
+
+			return Materialized<T_Source, Pipeline, State>(std::move(_node));
+		}
+	};
+
+	// Collection that tells the results materialized from its Observe()
+	// queries about every change, see IncrementalQuery. Elements keep the
+	// order they were added in. Not thread-safe.
+	template <typename T>
+	class ObservableCollection
+	{
+	public:
+		using value_type = T;
+
+		ObservableCollection(void) = default;
+		explicit ObservableCollection(std::vector<T> elements) : _elements(std::move(elements)) {}
+
+		ObservableCollection(const ObservableCollection&) = delete;
+		ObservableCollection& operator=(const ObservableCollection&) = delete;
+
+		void Add(T element)
+		{
+			_elements.push_back(std::move(element));
+			NotifyAdded(_elements.size() - 1);
+		}
+
+		// Adds the elements of 'range' as one batch
+		template <std::ranges::input_range Range>
+		void AddRange(const Range& range)
+		{
+			auto _first = _elements.size();
+
+			_elements.insert(_elements.end(), std::ranges::begin(range), std::ranges::end(range));
+			NotifyAdded(_first);
+		}
+
+		// Removes the first element equal to 'element', if any. Finding it
+		// is O(n), updating the results O(1) per result, O(log n) for Min/Max.
+		bool Remove(const T& element)
+		{
+			auto _position = std::find(_elements.begin(), _elements.end(), element);
+
+			if (_position == _elements.end())
+				return false;
+
+			RemoveAt(int(_position - _elements.begin()));
+
+			return true;
+		}
+
+		// Removing the last element does not move any other
+		void RemoveAt(int index)
+		{
+			if (index < 0 || size_t(index) >= _elements.size())
+				throw std::out_of_range("ObservableCollection<T>::RemoveAt() : 'index' is out of range");
+
+			ForEachObserver([&](detail::Observer<T>& observer) { observer.Removed(_elements[index]); });
+			_elements.erase(_elements.begin() + index);
+		}
+
+		void Clear(void)
+		{
+			ForEachObserver([&](detail::Observer<T>& observer)
+			{
+				for (const auto& x : _elements)
+					observer.Removed(x);
+			});
+			_elements.clear();
+		}
+
+		int Count(void) const { return int(_elements.size()); }
+
+		// Borrows the current elements, the view is invalidated by any change
+		auto AsEnumerable(void) const { return Enumerable<T, 0, std::allocator<T>>::View(_elements); }
+
+		// Starts a query whose results follow this collection
+		auto Observe(void) { return IncrementalQuery<T, T, detail::IdentityPipeline>(this, detail::IdentityPipeline()); }
+
+		const T* begin(void) const { return _elements.data(); }
+		const T* end(void) const { return _elements.data() + _elements.size(); }
+
+	private:
+		std::vector<T> _elements;
+		// Owned by the Materialized results, which may be gone already
+		std::vector<std::weak_ptr<detail::Observer<T>>> _observers;
+
+		template <typename, typename, typename>
+		friend class IncrementalQuery;
+
+		void NotifyAdded(size_t first)
+		{
+			auto _added = std::span<const T>(_elements).subspan(first);
+
+			ForEachObserver([&](detail::Observer<T>& observer) { observer.Added(_added); });
+		}
+
+		// Drops the observers that have been destroyed along the way
+		template <typename Function>
+		void ForEachObserver(Function func)
+		{
+			std::erase_if(_observers, [&](const std::weak_ptr<detail::Observer<T>>& x)
+			{
+				auto _observer = x.lock();
+
+				if (!_observer)
+					return true;
+
+				func(*_observer);
+				return false;
+			});
+		}
+	};
+}  // namespace linq
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <ranges>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "Lookup.hpp"
+
+namespace linq
+{
+	// How Enumerable<T>::Join() matches the two sides. Hash builds one hash
+	// table on the smaller side; Partitioned first splits both sides by key
+	// hash into partitions whose tables fit in cache, which pays off once
+	// the smaller side no longer does.
+	enum class JoinMode
+	{
+		Hash,
+		Partitioned
+	};
+
+	namespace detail
+	{
+		// Rows of the build side per partition in JoinMode::Partitioned
+		constexpr size_t JOIN_PARTITION_SIZE = 1 << 14;
+
+		// Groups the ids of the build side by key and probes the result with
+		// every id of the probe side, calling emit(probe id, build id) for
+		// every match. Matches of one probe id come in ascending build id
+		// order as long as 'build' is ascending.
+		template <typename T_Key, typename Build, typename Function_Build, typename Probe, typename Function_Probe, typename Function_Emit>
+		void hashJoin(const Build& build, Function_Build buildKey, const Probe& probe, Function_Probe probeKey, Function_Emit emit)
+		{
+			auto _table = Lookup<T_Key, size_t>::From(build, buildKey, [](size_t i) { return i; });
+
+			for (auto i : probe)
+				for (auto j : _table.Find(probeKey(i)))
+					emit(i, j);
+		}
+
+		// Splits [0, size) into 'partitions' runs of ascending ids by the hash
+		// of their keys. Uses bits of the mixed hash that KeyIndex does not
+		// bucket on, so every partition still spreads over its whole table.
+		template <typename T_Key>
+		auto partition(const std::vector<T_Key>& keys, size_t partitions)
+		{
+			auto _partitionOf = [&](const T_Key& key)
+			{
+				return size_t((uint64_t(std::hash<T_Key>()(key)) * 0x9E3779B97F4A7C15ull) >> 32) & (partitions - 1);
+			};
+
+			std::vector<size_t> _offsets(partitions + 1), _ids(keys.size());
+
+			for (const auto& key : keys)
+				_offsets[_partitionOf(key) + 1]++;
+			for (size_t p = 1; p <= partitions; p++)
+				_offsets[p] += _offsets[p - 1];
+
+			auto _next = _offsets;
+
+			for (size_t i = 0; i < keys.size(); i++)
+				_ids[_next[_partitionOf(keys[i])]++] = i;
+
+			return std::pair(std::move(_ids), std::move(_offsets));
+		}
+
+		// Calls emit(outer id, inner id) for every matching pair, in outer
+		// order and in inner order for the same outer id, which is the order
+		// Join() produces. Each key function runs once per id.
+		template <typename T_Key, typename Function_Outer, typename Function_Inner, typename Function_Emit>
+		void join(size_t outerSize, Function_Outer outerKey, size_t innerSize, Function_Inner innerKey, JoinMode mode, Function_Emit emit)
+		{
+			auto _buildInner = innerSize <= outerSize;
+			auto _buildSize = _buildInner ? innerSize : outerSize;
+			auto _partitions = std::bit_ceil(std::max<size_t>(_buildSize / JOIN_PARTITION_SIZE, 1));
+
+			// Probing the outer side in order through one table already yields
+			// the pairs in order, everything else collects them first
+			if (_buildInner && (mode == JoinMode::Hash || _partitions == 1))
+				return hashJoin<T_Key>(std::views::iota(size_t(0), innerSize), innerKey,
+					std::views::iota(size_t(0), outerSize), outerKey, emit);
+
+			std::vector<std::pair<size_t, size_t>> _pairs;
+			auto _collect = [&](size_t probe, size_t build)
+			{
+				if (_buildInner)
+					_pairs.emplace_back(probe, build);
+				else
+					_pairs.emplace_back(build, probe);
+			};
+
+			if (mode == JoinMode::Hash || _partitions == 1)
+			{
+				hashJoin<T_Key>(std::views::iota(size_t(0), outerSize), outerKey,
+					std::views::iota(size_t(0), innerSize), innerKey, _collect);
+			}
+			else
+			{
+				// Both sides need the hash of every key up front
+				std::vector<T_Key> _outerKeys, _innerKeys;
+
+				_outerKeys.reserve(outerSize);
+				for (size_t i = 0; i < outerSize; i++)
+					_outerKeys.push_back(outerKey(i));
+				_innerKeys.reserve(innerSize);
+				for (size_t i = 0; i < innerSize; i++)
+					_innerKeys.push_back(innerKey(i));
+
+				_partitions = std::min<size_t>(_partitions, 1 << 16);
+
+				auto [_outerIds, _outerOffsets] = partition(_outerKeys, _partitions);
+				auto [_innerIds, _innerOffsets] = partition(_innerKeys, _partitions);
+				auto _outerCached = [&](size_t i) -> const T_Key& { return _outerKeys[i]; };
+				auto _innerCached = [&](size_t i) -> const T_Key& { return _innerKeys[i]; };
+
+				for (size_t p = 0; p < _partitions; p++)
+				{
+					auto _outer = std::span<const size_t>(_outerIds).subspan(_outerOffsets[p], _outerOffsets[p + 1] - _outerOffsets[p]);
+					auto _inner = std::span<const size_t>(_innerIds).subspan(_innerOffsets[p], _innerOffsets[p + 1] - _innerOffsets[p]);
+
+					if (_buildInner)
+						hashJoin<T_Key>(_inner, _innerCached, _outer, _outerCached, _collect);
+					else
+						hashJoin<T_Key>(_outer, _outerCached, _inner, _innerCached, _collect);
+				}
+			}
+
+			// Stable counting sort by outer id, the inner ids of every outer id
+			// are ascending already
+			std::vector<size_t> _offsets(outerSize + 1);
+			std::vector<std::pair<size_t, size_t>> _sorted(_pairs.size());
+
+			for (const auto& pair : _pairs)
+				_offsets[pair.first + 1]++;
+			for (size_t i = 1; i <= outerSize; i++)
+				_offsets[i] += _offsets[i - 1];
+			for (const auto& pair : _pairs)
+				_sorted[_offsets[pair.first]++] = pair;
+
+			for (const auto& [o, i] : _sorted)
+				emit(o, i);
+		}
+	}  // namespace detail
+}  // namespace linq
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ranges>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "hashing.hpp"
+
+namespace linq
+{
+	template <typename T, size_t S, typename Allocator>
+	class Enumerable;
+
+	// Sequence elements grouped by key, created by Enumerable<T>::ToLookup()
+	// and Enumerable<T>::GroupBy(). Groups come in order of the first
+	// occurrence of their key and keep the source order of their elements.
+	// All groups share one buffer in which every group is a contiguous run,
+	// so a group is handed out as a view that must not outlive the Lookup.
+	template <typename T_Key, typename T_Element, typename Hasher = std::hash<T_Key>, typename Equality = std::equal_to<T_Key>>
+	class Lookup
+	{
+	public:
+		using key_type = T_Key;
+		using value_type = T_Element;
+
+		// Groups 'source' in one pass over it: every key is hashed once into
+		// an open-addressing index, then a counting sort over the group ids
+		// lays out the members of each group contiguously. 'elementSelector'
+		// runs once per element.
+		template <std::ranges::random_access_range Range, typename Function_Key, typename Function_Element>
+		static auto From(const Range& source, Function_Key keySelector, Function_Element elementSelector,
+			Hasher hasher = Hasher(), Equality equality = Equality())
+		{
+			Lookup _lookup(std::move(hasher), std::move(equality));
+			std::vector<uint32_t> _groupOf;
+			std::vector<size_t> _offsets{ 0 };
+
+			auto _size = size_t(std::ranges::size(source));
+
+			_groupOf.reserve(_size);
+			for (const auto& x : source)
+			{
+				auto [_id, _inserted] = _lookup._index.Insert(keySelector(x));
+
+				if (_inserted)
+					_offsets.push_back(0);
+				_offsets[_id + 1]++;
+				_groupOf.push_back(uint32_t(_id));
+			}
+
+			// Counts become the start offset of every group
+			for (size_t i = 1; i < _offsets.size(); i++)
+				_offsets[i] += _offsets[i - 1];
+
+			auto _next = _offsets;
+			std::vector<T_Element> _elements;
+
+			// Scatter straight into place when elements can be default
+			// constructed, otherwise go through an index list of the members
+			if constexpr (std::is_default_constructible_v<T_Element> && std::is_move_assignable_v<T_Element>)
+			{
+				_elements.resize(_size);
+				for (size_t i = 0; i < _size; i++)
+					_elements[_next[_groupOf[i]]++] = elementSelector(source[i]);
+			}
+			else
+			{
+				std::vector<size_t> _members(_size);
+
+				for (size_t i = 0; i < _size; i++)
+					_members[_next[_groupOf[i]]++] = i;
+
+				_elements.reserve(_size);
+				for (auto i : _members)
+					_elements.push_back(elementSelector(source[i]));
+			}
+
+			_lookup._offsets = std::move(_offsets);
+			_lookup._elements = std::move(_elements);
+
+			return _lookup;
+		}
+
+		bool Contains(const T_Key& key) const { return _index.Find(key) != decltype(_index)::NOT_FOUND; }
+
+		// Number of groups
+		int Count(void) const { return int(_index.Size()); }
+
+		const std::vector<T_Key>& Keys(void) const { return _index.Keys(); }
+
+		// The group of 'key', or an empty sequence when there is none
+		auto operator[](const T_Key& key) const { return Enumerable<T_Element, 0, std::allocator<T_Element>>::View(Find(key)); }
+
+		// The elements of the group of 'key', empty when there is none
+		std::span<const T_Element> Find(const T_Key& key) const
+		{
+			auto _id = _index.Find(key);
+
+			if (_id == decltype(_index)::NOT_FOUND)
+				return {};
+
+			return std::span<const T_Element>(_elements).subspan(_offsets[_id], _offsets[_id + 1] - _offsets[_id]);
+		}
+
+		// Maps every group to resultSelector(key, elements)
+		template <typename Function>
+		auto Select(Function resultSelector) const
+		{
+			using T_Out = std::remove_cvref_t<std::invoke_result_t<Function, const T_Key&, Enumerable<T_Element, 0, std::allocator<T_Element>>>>;
+
+			std::vector<T_Out> _newVec;
+
+			_newVec.reserve(_index.Size());
+			for (size_t i = 0; i < _index.Size(); i++)
+				_newVec.push_back(resultSelector(Keys()[i], Group(i)));
+
+			return Enumerable<T_Out, 0, std::allocator<T_Out>>(std::move(_newVec));
+		}
+
+		template <typename Function>
+		void foreach(Function func) const
+		{
+			for (size_t i = 0; i < _index.Size(); i++)
+				func(Keys()[i], Group(i));
+		}
+
+	private:
+		detail::KeyIndex<T_Key, Hasher, Equality> _index;
+		// Group i occupies [_offsets[i], _offsets[i + 1]) of _elements
+		std::vector<size_t> _offsets{ 0 };
+		std::vector<T_Element> _elements;
+
+		Lookup(Hasher hasher, Equality equality) : _index(0, std::move(hasher), std::move(equality)) {}
+
+		auto Group(size_t id) const
+		{
+			return Enumerable<T_Element, 0, std::allocator<T_Element>>::View(
+				std::span<const T_Element>(_elements).subspan(_offsets[id], _offsets[id + 1] - _offsets[id])
+			);
+		}
+	};
+}  // namespace linq
@@ -0,0 +1,347 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "concepts.hpp"
+#include "ThreadPool.hpp"
+
+namespace linq
+{
+	template <typename T, size_t S, typename Allocator>
+	class Enumerable;
+
+	namespace detail
+	{
+		// One level of an ordering, a key selector and its direction
+		template <typename Function, bool Descending>
+		struct OrderLevel
+		{
+			Function selector;
+
+			static constexpr bool descending = Descending;
+		};
+
+		template <typename Key>
+		concept RadixKey = std::integral<Key> && !std::same_as<Key, bool> && sizeof(Key) <= 8;
+
+		// Maps an integral key to an unsigned one that sorts the same way,
+		// or the opposite way for descending levels
+		template <bool Descending, RadixKey Key>
+		auto radixKey(Key key)
+		{
+			using U = std::make_unsigned_t<Key>;
+
+			auto _key = static_cast<U>(key);
+
+			if constexpr (std::is_signed_v<Key>)
+				_key ^= U(1) << (sizeof(Key) * 8 - 1);
+			if constexpr (Descending)
+				_key = static_cast<U>(~_key);
+
+			return _key;
+		}
+
+		// Stable LSD radix sort of 'order' by keys[order[i]], one byte per
+		// pass. Passes in which all keys share the same byte are skipped.
+		template <typename Index, typename U>
+		void radixSort(std::vector<size_t>& order, const std::vector<U>& keys)
+		{
+			struct Entry
+			{
+				U key;
+				Index index;
+			};
+
+			std::vector<Entry> _entries(order.size()), _buffer(order.size());
+			std::array<std::array<size_t, 256>, sizeof(U)> _counts{};
+
+			for (size_t i = 0; i < order.size(); i++)
+			{
+				_entries[i] = { keys[order[i]], static_cast<Index>(order[i]) };
+				for (size_t b = 0; b < sizeof(U); b++)
+					_counts[b][(_entries[i].key >> (8 * b)) & 0xFF]++;
+			}
+
+			for (size_t b = 0; b < sizeof(U) && order.size() != 0; b++)
+			{
+				if (_counts[b][(_entries[0].key >> (8 * b)) & 0xFF] == order.size())
+					continue;
+
+				std::array<size_t, 256> _next{};
+
+				for (size_t d = 1; d < 256; d++)
+					_next[d] = _next[d - 1] + _counts[b][d - 1];
+
+				for (const auto& entry : _entries)
+					_buffer[_next[(entry.key >> (8 * b)) & 0xFF]++] = entry;
+
+				std::swap(_entries, _buffer);
+			}
+
+			for (size_t i = 0; i < order.size(); i++)
+				order[i] = _entries[i].index;
+		}
+	}  // namespace detail
+
+	// Sequence sorted by one or more keys, created by Enumerable<T>::OrderBy()
+	// and OrderByDescending() and refined by ThenBy() and ThenByDescending().
+	// Nothing is sorted until a terminal operation runs; each key selector
+	// then runs exactly once per element and the keys are cached. Ties are
+	// broken by source position, so every ordering is stable.
+	// Sorting picks a radix sort when all keys are integral, and a parallel
+	// merge sort on ThreadPool::Default() for large inputs otherwise. Take()
+	// only sorts the first 'count' elements and First() and Last() scan once.
+	// Like Query, an ordering borrows the elements of the Enumerable it was
+	// created from, unless that was a temporary.
+	template <typename T, typename... Levels>
+	class OrderedEnumerable
+	{
+	public:
+		using value_type = T;
+
+		// Below this many elements the comparison sort stays on one thread
+		static constexpr size_t PARALLEL_THRESHOLD = 1 << 16;
+
+		OrderedEnumerable(std::span<const T> elements, std::tuple<Levels...> levels)
+			: _elements(elements), _levels(std::move(levels)) {}
+		OrderedEnumerable(std::shared_ptr<const std::vector<T>> owned, std::tuple<Levels...> levels)
+			: _elements(*owned), _owned(std::move(owned)), _levels(std::move(levels)) {}
+
+		template <Selector<T> Function>
+		auto ThenBy(Function keySelector) const { return Then<false>(keySelector); }
+
+		template <Selector<T> Function>
+		auto ThenByDescending(Function keySelector) const { return Then<true>(keySelector); }
+
+		auto Count(void) const { return int(_elements.size()); }
+
+		auto First(void) const
+		{
+			EnsureNotEmpty(__func__);
+
+			auto _keys = CacheKeys();
+			size_t _best = 0;
+
+			for (size_t i = 1; i < _elements.size(); i++)
+				if (Less(_keys, i, _best))
+					_best = i;
+
+			return _elements[_best];
+		}
+
+		auto Last(void) const
+		{
+			EnsureNotEmpty(__func__);
+
+			auto _keys = CacheKeys();
+			size_t _best = 0;
+
+			for (size_t i = 1; i < _elements.size(); i++)
+				if (Less(_keys, _best, i))
+					_best = i;
+
+			return _elements[_best];
+		}
+
+		// Partially sorts the 'count' smallest elements, O(n + k log k)
+		auto Take(int count) const
+		{
+			if (count <= 0)
+				return Enumerable<T, 0, std::allocator<T>>(std::vector<T>());
+			if (size_t(count) >= _elements.size())
+				return ToEnumerable();
+
+			auto _keys = CacheKeys();
+			auto _order = Identity();
+			auto _less = [&](size_t i, size_t j) { return Less(_keys, i, j); };
+
+			std::nth_element(std::begin(_order), std::begin(_order) + count, std::end(_order), _less);
+			std::sort(std::begin(_order), std::begin(_order) + count, _less);
+			_order.resize(count);
+
+			return Enumerable<T, 0, std::allocator<T>>(Gather(_order));
+		}
+
+		auto ToEnumerable(void) const { return Enumerable<T, 0, std::allocator<T>>(ToVector()); }
+
+		auto ToVector(void) const
+		{
+			auto _keys = CacheKeys();
+			auto _order = Identity();
+
+			if constexpr ((detail::RadixKey<KeyOf<Levels>> && ...))
+				RadixOrder<sizeof...(Levels) - 1>(_keys, _order);
+			else if (_elements.size() >= PARALLEL_THRESHOLD && ThreadPool::Default().Size() > 1)
+				ParallelSort(_keys, _order);
+			else
+				std::sort(std::begin(_order), std::end(_order), [&](size_t i, size_t j) { return Less(_keys, i, j); });
+
+			return Gather(_order);
+		}
+
+	private:
+		template <typename Level>
+		using KeyOf = std::remove_cvref_t<std::invoke_result_t<decltype(Level::selector)&, const T&>>;
+
+		using Keys = std::tuple<std::vector<KeyOf<Levels>>...>;
+
+		std::span<const T> _elements;
+		// Owns the elements when the ordering was created from a temporary
+		std::shared_ptr<const std::vector<T>> _owned;
+		std::tuple<Levels...> _levels;
+
+		template <typename, typename...>
+		friend class OrderedEnumerable;
+
+		template <bool Descending, typename Function>
+		auto Then(Function keySelector) const
+		{
+			using T_Next = OrderedEnumerable<T, Levels..., detail::OrderLevel<Function, Descending>>;
+
+			auto _next = std::tuple_cat(_levels, std::make_tuple(detail::OrderLevel<Function, Descending>{ keySelector }));
+
+			if (_owned)
+				return T_Next(_owned, std::move(_next));
+
+			return T_Next(_elements, std::move(_next));
+		}
+
+		void EnsureNotEmpty(const std::string& _mName) const
+		{
+			if (_elements.size() == 0)
+				throw std::runtime_error(std::string(
+					"OrderedEnumerable<T>::" + _mName + "() : The source sequence is empty"
+				));
+		}
+
+		Keys CacheKeys(void) const
+		{
+			return std::apply([&](const auto&... level)
+			{
+				auto _cache = [&](const auto& selector)
+				{
+					std::vector<std::remove_cvref_t<decltype(selector(_elements[0]))>> _keys;
+
+					_keys.reserve(_elements.size());
+					for (const auto& x : _elements)
+						_keys.push_back(selector(x));
+
+					return _keys;
+				};
+
+				return Keys(_cache(level.selector)...);
+			}, _levels);
+		}
+
+		template <size_t L = 0>
+		static bool Less(const Keys& keys, size_t i, size_t j)
+		{
+			if constexpr (L == sizeof...(Levels))
+				return i < j;
+			else
+			{
+				constexpr bool _descending = std::tuple_element_t<L, std::tuple<Levels...>>::descending;
+				const auto& _keys = std::get<L>(keys);
+
+				if (_keys[i] < _keys[j])
+					return !_descending;
+				if (_keys[j] < _keys[i])
+					return _descending;
+
+				return Less<L + 1>(keys, i, j);
+			}
+		}
+
+		std::vector<size_t> Identity(void) const
+		{
+			std::vector<size_t> _order(_elements.size());
+
+			std::iota(std::begin(_order), std::end(_order), size_t(0));
+
+			return _order;
+		}
+
+		// Radix sorts by the least significant level first, every pass being
+		// stable keeps the order of the more significant ones
+		template <size_t L>
+		static void RadixOrder(const Keys& keys, std::vector<size_t>& order)
+		{
+			constexpr bool _descending = std::tuple_element_t<L, std::tuple<Levels...>>::descending;
+			const auto& _keys = std::get<L>(keys);
+
+			std::vector<decltype(detail::radixKey<_descending>(_keys[0]))> _radixKeys;
+
+			_radixKeys.reserve(_keys.size());
+			for (auto key : _keys)
+				_radixKeys.push_back(detail::radixKey<_descending>(key));
+
+			// Narrower indices make the entries shuffled by every pass smaller
+			if (order.size() <= std::numeric_limits<uint32_t>::max())
+				detail::radixSort<uint32_t>(order, _radixKeys);
+			else
+				detail::radixSort<size_t>(order, _radixKeys);
+
+			if constexpr (L > 0)
+				RadixOrder<L - 1>(keys, order);
+		}
+
+		// Sorts one chunk per worker, then merges pairs of sorted runs in
+		// parallel until one is left. Less() is a strict total order, so
+		// the result is the same as that of a sequential stable sort.
+		static void ParallelSort(const Keys& keys, std::vector<size_t>& order)
+		{
+			auto& _pool = ThreadPool::Default();
+			auto _less = [&](size_t i, size_t j) { return Less(keys, i, j); };
+			auto _bound = [&](size_t run, size_t runs) { return order.size() * run / runs; };
+
+			size_t _runs = 1;
+
+			while (_runs < _pool.Size())
+				_runs *= 2;
+
+			_pool.ParallelFor(_runs, [&](size_t i)
+			{
+				std::sort(std::begin(order) + _bound(i, _runs), std::begin(order) + _bound(i + 1, _runs), _less);
+			});
+
+			std::vector<size_t> _buffer(order.size());
+
+			for (; _runs > 1; _runs /= 2)
+			{
+				_pool.ParallelFor(_runs / 2, [&](size_t i)
+				{
+					auto _first = std::begin(order) + _bound(2 * i, _runs);
+					auto _middle = std::begin(order) + _bound(2 * i + 1, _runs);
+					auto _last = std::begin(order) + _bound(2 * i + 2, _runs);
+
+					std::merge(_first, _middle, _middle, _last, std::begin(_buffer) + _bound(2 * i, _runs), _less);
+				});
+
+				std::swap(order, _buffer);
+			}
+		}
+
+		std::vector<T> Gather(const std::vector<size_t>& order) const
+		{
+			std::vector<T> _newVec;
+
+			_newVec.reserve(order.size());
+			for (auto i : order)
+				_newVec.push_back(_elements[i]);
+
+			return _newVec;
+		}
+	};
+}  // namespace linq
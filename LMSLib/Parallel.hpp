@@ -0,0 +1,353 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "concepts.hpp"
+#include "Simd.hpp"
+#include "Sketches.hpp"
+#include "Summation.hpp"
+#include "ThreadPool.hpp"
+
+namespace linq
+{
+	template <typename T, size_t S, typename Allocator>
+	class Enumerable;
+
+	// Parallel counterpart of Enumerable, created by Enumerable<T>::AsParallel().
+	// The elements are split into chunks that run on a ThreadPool, and the
+	// partial results are combined afterwards, so functions passed to the
+	// reductions have to be associative. Select() and Where() keep the source
+	// order unless AsUnordered() was requested.
+	template <typename T>
+	class ParallelQuery
+	{
+	public:
+		using value_type = T;
+
+		// Below this many elements per chunk the scheduling overhead dominates
+		static constexpr size_t MIN_CHUNK_SIZE = 4096;
+
+		ParallelQuery(std::span<const T> elements, ThreadPool& pool) : _elements(elements), _pool(&pool) {}
+
+		auto AsOrdered(void) const
+		{
+			auto _query = *this;
+			_query._ordered = true;
+			return _query;
+		}
+
+		auto AsUnordered(void) const
+		{
+			auto _query = *this;
+			_query._ordered = false;
+			return _query;
+		}
+
+		template <Accumulator<T> Function>
+		auto Aggregate(Function func) const
+		{
+			auto _partials = Partials([&](std::span<const T> chunk)
+			{
+				T _aggregate = chunk[0];
+
+				for (size_t i = 1; i < chunk.size(); i++)
+					_aggregate = func(_aggregate, chunk[i]);
+
+				return _aggregate;
+			});
+
+			if (_partials.size() == 0)
+				throw std::runtime_error("ParallelQuery<T>::Aggregate() : The source sequence is empty");
+
+			return Combine(_partials, func);
+		}
+
+		// 'func' folds elements into a per-chunk accumulator starting at 'seed',
+		// 'combine' merges two accumulators
+		template <typename T_Accumulate, typename Function, typename Function_Combine>
+		auto Aggregate(T_Accumulate seed, Function func, Function_Combine combine) const
+		{
+			auto _partials = Partials([&](std::span<const T> chunk)
+			{
+				auto _aggregate = seed;
+
+				for (const auto& x : chunk)
+					_aggregate = func(_aggregate, x);
+
+				return _aggregate;
+			});
+
+			return _partials.size() == 0 ? seed : Combine(_partials, combine);
+		}
+
+		template <Predicate<T> Function>
+		auto All(Function predicate) const
+		{
+			return !Any([&](const T& x) { return !predicate(x); });
+		}
+
+		auto Any(void) const { return _elements.size() != 0; }
+
+		template <Predicate<T> Function>
+		auto Any(Function predicate) const
+		{
+			std::atomic<bool> _found = false;
+
+			Partials([&](std::span<const T> chunk)
+			{
+				for (const auto& x : chunk)
+				{
+					if (_found.load(std::memory_order_relaxed))
+						break;
+					if (predicate(x))
+					{
+						_found.store(true, std::memory_order_relaxed);
+						break;
+					}
+				}
+				return true;
+			});
+
+			return _found.load();
+		}
+
+		size_t ApproxCountDistinct(int precision = 12) const requires Hashable<T>
+		{
+			return size_t(std::llround(Sketch(sketches::HyperLogLog<T>(precision)).Estimate()));
+		}
+
+		T ApproxQuantile(double q, int k = 200) const requires Ordered<T>
+		{
+			EnsureNotEmpty(__func__);
+			if (!(q >= 0 && q <= 1))
+				throw std::out_of_range("ParallelQuery<T>::ApproxQuantile() : 'q' is not in [0, 1]");
+
+			return Sketch(sketches::QuantileSketch<T>(k)).Quantile(q);
+		}
+
+		// See Enumerable<T>::Average()
+		template <std::floating_point T_Result = float>
+		T_Result Average(Summation summation = Summation::Naive) const requires Arithmetic<T>
+		{
+			return summation::Mean<T_Result>(Sum<summation::Wide<T>>(summation), _elements.size());
+		}
+
+		auto Count(void) const { return int(_elements.size()); }
+
+		template <Predicate<T> Function>
+		auto Count(Function predicate) const
+		{
+			return Aggregate(0, [&](int count, const T& x) { return predicate(x) ? count + 1 : count; }, std::plus<int>());
+		}
+
+		auto Max(void) const
+		{
+			EnsureNotEmpty(__func__);
+			return Aggregate([](const T& x, const T& y) { return x < y ? y : x; });
+		}
+
+		auto Min(void) const
+		{
+			EnsureNotEmpty(__func__);
+			return Aggregate([](const T& x, const T& y) { return y < x ? y : x; });
+		}
+
+		template <Selector<T> Function>
+		auto Select(Function selector) const
+		{
+			using T_Out = std::remove_cvref_t<typename std::invoke_result<Function, T>::type>;
+
+			return Gather<T_Out>([&](std::span<const T> chunk)
+			{
+				std::vector<T_Out> _newVec;
+
+				_newVec.reserve(chunk.size());
+				for (const auto& x : chunk)
+					_newVec.push_back(selector(x));
+
+				return _newVec;
+			});
+		}
+
+		// See Enumerable<T>::Sum(). The sums of the chunks are added up in
+		// the same way as their elements.
+		template <Arithmetic T_Sum = T>
+		T_Sum Sum(Summation summation = Summation::Naive) const requires Arithmetic<T>
+		{
+			auto _partials = Partials([&](std::span<const T> chunk)
+			{
+				if constexpr (simd::Accumulable<T_Sum, T>)
+					return simd::Accumulate<T_Sum>(chunk, summation);
+				else
+					return summation::Accumulate<T_Sum>(summation, [&](auto add) { std::for_each(std::begin(chunk), std::end(chunk), add); });
+			});
+
+			return summation::Accumulate<T_Sum>(summation, [&](auto add) { std::for_each(std::begin(_partials), std::end(_partials), add); });
+		}
+
+		auto ToEnumerable(void) const { return Enumerable<T, 0, std::allocator<T>>(ToVector()); }
+
+		auto ToVector(void) const { return std::vector<T>(std::begin(_elements), std::end(_elements)); }
+
+		auto TopKFrequent(int k, int capacity = 0) const requires Hashable<T>
+		{
+			if (k <= 0)
+				throw std::out_of_range("ParallelQuery<T>::TopKFrequent() : 'k' is less than 1");
+
+			return Sketch(sketches::HeavyHitters<T>(capacity > 0 ? capacity : 10 * k)).Top(k);
+		}
+
+		template <Predicate<T> Function>
+		auto Where(Function predicate) const
+		{
+			return Gather<T>([&](std::span<const T> chunk)
+			{
+				std::vector<T> _newVec;
+
+				for (const auto& x : chunk)
+					if (predicate(x))
+						_newVec.push_back(x);
+
+				return _newVec;
+			});
+		}
+
+	private:
+		std::span<const T> _elements;
+		// Owns the elements when they were produced by Select() or Where()
+		std::shared_ptr<const std::vector<T>> _owned;
+		ThreadPool* _pool;
+		bool _ordered = true;
+
+		template <typename>
+		friend class ParallelQuery;
+
+		ParallelQuery(std::shared_ptr<const std::vector<T>> owned, ThreadPool* pool, bool ordered)
+			: _elements(*owned), _owned(std::move(owned)), _pool(pool), _ordered(ordered) {}
+
+		void EnsureNotEmpty(const std::string& _mName) const
+		{
+			if (_elements.size() == 0)
+				throw std::runtime_error(std::string(
+					"ParallelQuery<T>::" + _mName + "() : The source sequence is empty"
+				));
+		}
+
+		size_t ChunkCount(void) const
+		{
+			if (_elements.size() == 0)
+				return 0;
+
+			auto _chunks = std::min(_elements.size() / MIN_CHUNK_SIZE, _pool->Size() * 4);
+
+			return std::max<size_t>(_chunks, 1);
+		}
+
+		std::span<const T> Chunk(size_t index, size_t chunks) const
+		{
+			auto _begin = _elements.size() * index / chunks;
+			auto _end = _elements.size() * (index + 1) / chunks;
+
+			return _elements.subspan(_begin, _end - _begin);
+		}
+
+		// Runs 'func' on every chunk and returns the results in chunk order.
+		// A single chunk runs inline without touching the pool.
+		template <typename Function>
+		auto Partials(Function func) const
+		{
+			using T_Partial = std::invoke_result_t<Function&, std::span<const T>>;
+
+			auto _chunks = ChunkCount();
+			std::vector<std::optional<T_Partial>> _partials(_chunks);
+
+			if (_chunks == 1)
+				_partials[0].emplace(func(Chunk(0, 1)));
+			else if (_chunks > 1)
+				_pool->ParallelFor(_chunks, [&](size_t i) { _partials[i].emplace(func(Chunk(i, _chunks))); });
+
+			std::vector<T_Partial> _results;
+
+			_results.reserve(_chunks);
+			for (auto& partial : _partials)
+				_results.push_back(std::move(*partial));
+
+			return _results;
+		}
+
+		template <typename T_Partial, typename Function>
+		static auto Combine(std::vector<T_Partial>& partials, Function combine)
+		{
+			auto _result = std::move(partials[0]);
+
+			for (size_t i = 1; i < partials.size(); i++)
+				_result = combine(_result, partials[i]);
+
+			return _result;
+		}
+
+		// Fills a copy of the empty 'sketch' per chunk and merges them in
+		// chunk order
+		template <typename T_Sketch>
+		T_Sketch Sketch(const T_Sketch& sketch) const
+		{
+			auto _partials = Partials([&](std::span<const T> chunk)
+			{
+				auto _partial = sketch;
+
+				for (const auto& x : chunk)
+					_partial.Add(x);
+
+				return _partial;
+			});
+
+			auto _sketch = sketch;
+
+			for (const auto& partial : _partials)
+				_sketch.Merge(partial);
+
+			return _sketch;
+		}
+
+		// Concatenates per-chunk output vectors into a new query, either in
+		// chunk order or in the order the chunks finished
+		template <typename T_Out, typename Function>
+		auto Gather(Function func) const
+		{
+			auto _newVec = std::make_shared<std::vector<T_Out>>();
+
+			if (_ordered)
+			{
+				for (auto& partial : Partials(func))
+					_newVec->insert(std::end(*_newVec), std::make_move_iterator(std::begin(partial)),
+						std::make_move_iterator(std::end(partial)));
+			}
+			else
+			{
+				std::mutex _mutex;
+
+				Partials([&](std::span<const T> chunk)
+				{
+					auto _partial = func(chunk);
+					std::lock_guard _lock(_mutex);
+
+					_newVec->insert(std::end(*_newVec), std::make_move_iterator(std::begin(_partial)),
+						std::make_move_iterator(std::end(_partial)));
+					return true;
+				});
+			}
+
+			return ParallelQuery<T_Out>(std::shared_ptr<const std::vector<T_Out>>(std::move(_newVec)), _pool, _ordered);
+		}
+	};
+}  // namespace linq
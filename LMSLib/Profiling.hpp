@@ -0,0 +1,268 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "allocations.hpp"
+
+namespace linq
+{
+	// Opt-in instrumentation of lazy queries, see Query<Stage>::Profile()
+	namespace profiling
+	{
+		// Every how many elements an operator times the operators after it,
+		// for the time it spent itself; reading the clock twice for every
+		// element would cost more than most operators do. A prime, so that
+		// the samples do not line up with periodic data.
+		constexpr size_t TIME_SAMPLING = 31;
+
+		// What one operator of a query did during one terminal operation.
+		// Times and allocations are exclusive: what the operator spent
+		// itself, not waiting for the operators before or after it.
+		struct OperatorStats
+		{
+			std::string name;
+			size_t elementsIn = 0;
+			size_t elementsOut = 0;
+			double milliseconds = 0;
+			size_t allocations = 0;
+			size_t allocatedBytes = 0;
+			// Elements copied into buffers of the operator, e.g. by Reverse()
+			size_t bytesCopied = 0;
+		};
+
+		// The operators of a query from its sources to the terminal operation
+		struct Report
+		{
+			std::vector<OperatorStats> operators;
+
+			std::string ToJson(void) const
+			{
+				std::string _json = "{\"operators\": [";
+
+				for (size_t i = 0; i < operators.size(); i++)
+				{
+					const auto& _stats = operators[i];
+					std::string _name;
+
+					for (auto c : _stats.name)
+					{
+						if (c == '"' || c == '\\')
+							_name += '\\';
+						_name += c;
+					}
+
+					_json += std::string(i == 0 ? "" : ", ") + "{\"name\": \"" + _name + "\""
+						+ ", \"elements_in\": " + std::to_string(_stats.elementsIn)
+						+ ", \"elements_out\": " + std::to_string(_stats.elementsOut)
+						+ ", \"time_ms\": " + std::to_string(_stats.milliseconds)
+						+ ", \"allocations\": " + std::to_string(_stats.allocations)
+						+ ", \"allocated_bytes\": " + std::to_string(_stats.allocatedBytes)
+						+ ", \"bytes_copied\": " + std::to_string(_stats.bytesCopied) + "}";
+				}
+
+				return _json + "]}";
+			}
+		};
+
+		// Collects the measurements of profiled queries and turns them into a
+		// Report after every terminal operation. Measuring costs allocation
+		// counter reads per element and operator, and clock reads for every
+		// TIME_SAMPLING-th, so profiled queries run slower than the numbers
+		// they report add up to. Not thread-safe.
+		class Profiler
+		{
+		public:
+			// Allocations are only counted given a function that reads the
+			// global counters, e.g. linq::allocationStats
+			explicit Profiler(AllocationStats(*allocationCounter)(void) = nullptr) : _allocationCounter(allocationCounter)
+			{
+				// So that keeping the records does not count as allocations
+				// of the operators, unless a query has more of them
+				_records.reserve(32);
+				_open.reserve(32);
+
+				// What timing nothing takes, which every sample is off by
+				_clockCost = std::chrono::steady_clock::duration::max();
+				for (int i = 0; i < 64; i++)
+				{
+					auto _start = std::chrono::steady_clock::now();
+
+					_clockCost = std::min(_clockCost, std::chrono::steady_clock::now() - _start);
+				}
+			}
+
+			// Called with the report of every terminal operation
+			void OnReport(std::function<void(const Report&)> callback) { _callback = std::move(callback); }
+
+			const Report& LastReport(void) const { return _report; }
+
+			// Measurements of one operator, taken while the query runs. The
+			// name belongs to the operator.
+			struct Record
+			{
+				const char* name;
+				int parent;
+				size_t elementsOut = 0;
+				std::chrono::steady_clock::duration total{}, downstream{};
+				size_t downstreamSamples = 0;
+				AllocationStats allocations{}, allocationsDownstream{};
+				size_t bytesPerInput = 0;
+				size_t bytesPerOutput = 0;
+			};
+
+			// Starts the record of an operator whose Run() just began, nested
+			// in the operator that is running at the moment
+			int Begin(const char* name, size_t bytesPerInput = 0, size_t bytesPerOutput = 0)
+			{
+				_records.push_back({ name, _open.empty() ? -1 : _open.back() });
+				_records.back().bytesPerInput = bytesPerInput;
+				_records.back().bytesPerOutput = bytesPerOutput;
+				_open.push_back(int(_records.size() - 1));
+
+				return _open.back();
+			}
+
+			// Ends the innermost record; the report is made when the terminal
+			// operation, the outermost one, ends
+			void End(void)
+			{
+				_open.pop_back();
+				if (_open.empty())
+					Finish();
+			}
+
+			// Whether a terminal operation is being measured already
+			bool Running(void) const { return !_open.empty(); }
+
+			Record& operator[](int id) { return _records[id]; }
+
+			AllocationStats Allocations(void) const { return _allocationCounter ? _allocationCounter() : AllocationStats{ 0, 0 }; }
+
+		private:
+			AllocationStats(*_allocationCounter)(void);
+			std::function<void(const Report&)> _callback;
+			std::vector<Record> _records;
+			// Records whose operators are running, innermost last
+			std::vector<int> _open;
+			Report _report;
+			std::chrono::steady_clock::duration _clockCost;
+
+			void Finish(void)
+			{
+				_report.operators.clear();
+				for (int i = 0; i < int(_records.size()); i++)
+					if (_records[i].parent == -1)
+						Add(i);
+				_records.clear();
+
+				if (_callback)
+					_callback(_report);
+			}
+
+			// Adds the operators that feed 'id' first, then 'id' itself with
+			// what its inputs spent taken out of its own totals
+			void Add(int id)
+			{
+				const auto& _record = _records[id];
+				auto _time = _record.total - Downstream(_record);
+				auto _count = _record.allocations.count - _record.allocationsDownstream.count;
+				auto _bytes = _record.allocations.bytes - _record.allocationsDownstream.bytes;
+				size_t _in = 0;
+				auto _leaf = true;
+
+				for (int i = id + 1; i < int(_records.size()); i++)
+				{
+					const auto& _input = _records[i];
+
+					if (_input.parent != id)
+						continue;
+
+					Add(i);
+					_leaf = false;
+					_in += _input.elementsOut;
+					_time -= _input.total - Downstream(_input);
+					_count -= _input.allocations.count - _input.allocationsDownstream.count;
+					_bytes -= _input.allocations.bytes - _input.allocationsDownstream.bytes;
+				}
+
+				OperatorStats _stats;
+
+				_stats.name = _record.name;
+				_stats.elementsIn = _leaf ? _record.elementsOut : _in;
+				_stats.elementsOut = _record.elementsOut;
+				_stats.milliseconds = std::max(0.0, std::chrono::duration<double, std::milli>(_time).count());
+				_stats.allocations = _count;
+				_stats.allocatedBytes = _bytes;
+				_stats.bytesCopied = _stats.elementsIn * _record.bytesPerInput + _stats.elementsOut * _record.bytesPerOutput;
+				_report.operators.push_back(std::move(_stats));
+			}
+
+			// The time spent downstream of all elements, from the samples,
+			// plus the time taking them took
+			std::chrono::steady_clock::duration Downstream(const Record& record) const
+			{
+				if (record.downstreamSamples == 0)
+					return {};
+
+				auto _samples = std::chrono::steady_clock::rep(record.downstreamSamples);
+				auto _overhead = _clockCost * _samples;
+				auto _sampled = std::max(record.downstream - _overhead, std::chrono::steady_clock::duration::zero());
+
+				return _sampled * std::chrono::steady_clock::rep(record.elementsOut) / _samples + _overhead;
+			}
+		};
+
+		// Measures an operator from its construction to its destruction
+		class Scope
+		{
+		public:
+			Scope(Profiler& profiler, const char* name, size_t bytesPerInput = 0, size_t bytesPerOutput = 0)
+				: _profiler(profiler), _id(profiler.Begin(name, bytesPerInput, bytesPerOutput)),
+				_allocations(profiler.Allocations()), _start(std::chrono::steady_clock::now())
+			{
+			}
+
+			Scope(const Scope&) = delete;
+			Scope& operator=(const Scope&) = delete;
+
+			~Scope(void)
+			{
+				auto& _record = _profiler[_id];
+				auto _allocationsEnd = _profiler.Allocations();
+
+				_record.total += std::chrono::steady_clock::now() - _start;
+				_record.allocations.count += _allocationsEnd.count - _allocations.count;
+				_record.allocations.bytes += _allocationsEnd.bytes - _allocations.bytes;
+				_profiler.End();
+			}
+
+			int Id(void) const { return _id; }
+
+		private:
+			Profiler& _profiler;
+			int _id;
+			AllocationStats _allocations;
+			std::chrono::steady_clock::time_point _start;
+		};
+
+		// Policies of Query<Stage, Policy>. Disabled queries are built from
+		// the bare stages, enabled ones wrap every operator in a probe.
+		struct Disabled
+		{
+			static constexpr bool enabled = false;
+		};
+
+		struct Enabled
+		{
+			static constexpr bool enabled = true;
+
+			Profiler* profiler;
+		};
+	}  // namespace profiling
+}  // namespace linq
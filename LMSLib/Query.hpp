@@ -0,0 +1,1192 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "concepts.hpp"
+#include "hashing.hpp"
+#include "Profiling.hpp"
+#include "Sketches.hpp"
+#include "Summation.hpp"
+
+namespace linq
+{
+	template <typename T, size_t S, typename Allocator>
+	class Enumerable;
+
+	// Elements per block that foreachBatch() hands out unless told
+	// otherwise, about 16KB so that a block stays in the L1 cache
+	template <typename T>
+	constexpr int BATCH_SIZE = sizeof(T) >= 16384 ? 1 : int(16384 / sizeof(T));
+
+	namespace detail
+	{
+		// Where() after Where() tests both predicates in one stage
+		template <typename First, typename Second>
+		struct Conjunction
+		{
+			First first;
+			Second second;
+
+			template <typename T>
+			bool operator()(const T& x) const { return first(x) && second(x); }
+		};
+
+		template <typename Function>
+		struct PredicateCount : std::integral_constant<int, 1> {};
+
+		template <typename First, typename Second>
+		struct PredicateCount<Conjunction<First, Second>>
+			: std::integral_constant<int, PredicateCount<First>::value + PredicateCount<Second>::value> {};
+
+		template <typename Function>
+		constexpr int predicateCount(void) { return PredicateCount<Function>::value; }
+
+		// Whether 'Stage' is an instance of the stage template 'Kind'
+		template <typename Stage, template <typename...> class Kind>
+		struct IsStage : std::false_type {};
+
+		template <template <typename...> class Kind, typename... Args>
+		struct IsStage<Kind<Args...>, Kind> : std::true_type {};
+
+		// Whether the elements of 'Stage' are references into the data of
+		// its source, which outlives the run
+		template <typename Stage>
+		struct BorrowsSource : std::false_type {};
+
+		// Bytes a stage copies into buffers of its own per element it takes
+		// in and per element it passes on, see OperatorStats::bytesCopied
+		template <typename Stage>
+		struct CopiedBytes
+		{
+			static constexpr size_t input = 0;
+			static constexpr size_t output = 0;
+		};
+	}  // namespace detail
+
+	// Deferred-execution stages. Every stage pushes its elements into a sink
+	// that returns false once it does not want any more elements, so a whole
+	// chain runs as a single fused pass and stops as soon as possible.
+	// Run() returns false only when the sink asked to stop.
+	namespace stages
+	{
+		template <typename T>
+		class ReverseSource;
+
+		template <typename T>
+		class Source
+		{
+		public:
+			using value_type = T;
+
+			Source(const T* data, size_t size) : _data(data), _size(size) {}
+
+			auto Reversed(void) const { return ReverseSource<T>(_data, _size); }
+
+			// Skip() and Take() narrow the source instead of adding a stage
+			Source Slice(size_t offset, size_t count) const
+			{
+				offset = std::min(offset, _size);
+				return Source(_data + offset, std::min(count, _size - offset));
+			}
+
+			size_t Size(void) const { return _size; }
+			const T& operator[](size_t index) const { return _data[index]; }
+
+			std::string Explain(void) const { return "Source(" + std::to_string(_size) + ")"; }
+
+			template <typename Sink>
+			bool Run(Sink&& sink) const
+			{
+				for (size_t i = 0; i < _size; i++)
+					if (!sink(_data[i]))
+						return false;
+
+				return true;
+			}
+
+		private:
+			const T* _data;
+			size_t _size;
+		};
+
+		template <typename T>
+		class ReverseSource
+		{
+		public:
+			using value_type = T;
+
+			ReverseSource(const T* data, size_t size) : _data(data), _size(size) {}
+
+			auto Reversed(void) const { return Source<T>(_data, _size); }
+
+			// Offsets count from the back, where iteration starts
+			ReverseSource Slice(size_t offset, size_t count) const
+			{
+				offset = std::min(offset, _size);
+				count = std::min(count, _size - offset);
+				return ReverseSource(_data + (_size - offset - count), count);
+			}
+
+			size_t Size(void) const { return _size; }
+			const T& operator[](size_t index) const { return _data[_size - 1 - index]; }
+
+			std::string Explain(void) const { return "ReverseSource(" + std::to_string(_size) + ")"; }
+
+			template <typename Sink>
+			bool Run(Sink&& sink) const
+			{
+				for (size_t i = _size; i > 0; i--)
+					if (!sink(_data[i - 1]))
+						return false;
+
+				return true;
+			}
+
+		private:
+			const T* _data;
+			size_t _size;
+		};
+
+		template <typename Iterator>
+		class IteratorSource
+		{
+		public:
+			using value_type = std::iter_value_t<Iterator>;
+
+			IteratorSource(Iterator first, Iterator last) : _first(first), _last(last) {}
+
+			std::string Explain(void) const { return "IteratorSource"; }
+
+			template <typename Sink>
+			bool Run(Sink&& sink) const
+			{
+				for (auto it = _first; it != _last; ++it)
+					if (!sink(*it))
+						return false;
+
+				return true;
+			}
+
+		private:
+			Iterator _first;
+			Iterator _last;
+		};
+
+		template <typename Stage, typename Function>
+		class Where
+		{
+		public:
+			using value_type = typename Stage::value_type;
+
+			Where(Stage stage, Function predicate) : _stage(std::move(stage)), _predicate(std::move(predicate)) {}
+
+			const Stage& Inner(void) const { return _stage; }
+			const Function& Condition(void) const { return _predicate; }
+
+			std::string Explain(void) const
+			{
+				auto _count = detail::predicateCount<Function>();
+
+				return _stage.Explain() + " -> Where" + (_count > 1 ? "(" + std::to_string(_count) + " predicates)" : "");
+			}
+
+			template <typename Sink>
+			bool Run(Sink&& sink) const
+			{
+				return _stage.Run([&](auto&& x)
+				{
+					if (_predicate(x))
+						return sink(std::forward<decltype(x)>(x));
+					return true;
+				});
+			}
+
+		private:
+			Stage _stage;
+			Function _predicate;
+		};
+
+		template <typename Stage, typename Function>
+		class Select
+		{
+		public:
+			using value_type = std::remove_cvref_t<std::invoke_result_t<const Function&, const typename Stage::value_type&>>;
+
+			Select(Stage stage, Function selector) : _stage(std::move(stage)), _selector(std::move(selector)) {}
+
+			const Stage& Inner(void) const { return _stage; }
+			const Function& Projection(void) const { return _selector; }
+
+			std::string Explain(void) const { return _stage.Explain() + " -> Select"; }
+
+			template <typename Sink>
+			bool Run(Sink&& sink) const
+			{
+				return _stage.Run([&](auto&& x) { return sink(_selector(x)); });
+			}
+
+		private:
+			Stage _stage;
+			Function _selector;
+		};
+
+		template <typename Stage>
+		class Skip
+		{
+		public:
+			using value_type = typename Stage::value_type;
+
+			Skip(Stage stage, int count) : _stage(std::move(stage)), _count(count) {}
+
+			std::string Explain(void) const { return _stage.Explain() + " -> Skip(" + std::to_string(_count) + ")"; }
+
+			template <typename Sink>
+			bool Run(Sink&& sink) const
+			{
+				auto _i = 0;
+
+				return _stage.Run([&](auto&& x)
+				{
+					if (_i < _count)
+					{
+						_i++;
+						return true;
+					}
+					return sink(std::forward<decltype(x)>(x));
+				});
+			}
+
+		private:
+			Stage _stage;
+			int _count;
+		};
+
+		template <typename Stage>
+		class Take
+		{
+		public:
+			using value_type = typename Stage::value_type;
+
+			Take(Stage stage, int count) : _stage(std::move(stage)), _count(count) {}
+
+			std::string Explain(void) const { return _stage.Explain() + " -> Take(" + std::to_string(_count) + ")"; }
+
+			template <typename Sink>
+			bool Run(Sink&& sink) const
+			{
+				auto _i = 0;
+				auto _continue = true;
+
+				if (_count <= 0)
+					return true;
+
+				_stage.Run([&](auto&& x)
+				{
+					_continue = sink(std::forward<decltype(x)>(x));
+					return _continue && ++_i < _count;
+				});
+
+				return _continue;
+			}
+
+		private:
+			Stage _stage;
+			int _count;
+		};
+
+		template <typename Stage, typename Function>
+		class SkipWhile
+		{
+		public:
+			using value_type = typename Stage::value_type;
+
+			SkipWhile(Stage stage, Function predicate) : _stage(std::move(stage)), _predicate(std::move(predicate)) {}
+
+			std::string Explain(void) const { return _stage.Explain() + " -> SkipWhile"; }
+
+			template <typename Sink>
+			bool Run(Sink&& sink) const
+			{
+				auto _skip = true;
+				auto _i = 0;
+
+				return _stage.Run([&](auto&& x)
+				{
+					if (_skip)
+					{
+						if constexpr (std::is_invocable_v<const Function&, const value_type&, int>)
+							_skip = _predicate(x, _i++);
+						else
+							_skip = _predicate(x);
+					}
+					if (_skip)
+						return true;
+					return sink(std::forward<decltype(x)>(x));
+				});
+			}
+
+		private:
+			Stage _stage;
+			Function _predicate;
+		};
+
+		template <typename Stage, typename Function>
+		class TakeWhile
+		{
+		public:
+			using value_type = typename Stage::value_type;
+
+			TakeWhile(Stage stage, Function predicate) : _stage(std::move(stage)), _predicate(std::move(predicate)) {}
+
+			std::string Explain(void) const { return _stage.Explain() + " -> TakeWhile"; }
+
+			template <typename Sink>
+			bool Run(Sink&& sink) const
+			{
+				auto _i = 0;
+				auto _continue = true;
+
+				_stage.Run([&](auto&& x)
+				{
+					bool _take;
+
+					if constexpr (std::is_invocable_v<const Function&, const value_type&, int>)
+						_take = _predicate(x, _i++);
+					else
+						_take = _predicate(x);
+
+					if (!_take)
+						return false;
+					_continue = sink(std::forward<decltype(x)>(x));
+					return _continue;
+				});
+
+				return _continue;
+			}
+
+		private:
+			Stage _stage;
+			Function _predicate;
+		};
+
+		template <typename Stage>
+		class Prepend
+		{
+		public:
+			using value_type = typename Stage::value_type;
+
+			Prepend(Stage stage, value_type element) : _stage(std::move(stage)), _element(std::move(element)) {}
+
+			std::string Explain(void) const { return _stage.Explain() + " -> Prepend"; }
+
+			template <typename Sink>
+			bool Run(Sink&& sink) const
+			{
+				return sink(_element) && _stage.Run(sink);
+			}
+
+		private:
+			Stage _stage;
+			value_type _element;
+		};
+
+		template <typename Stage>
+		class Append
+		{
+		public:
+			using value_type = typename Stage::value_type;
+
+			Append(Stage stage, value_type element) : _stage(std::move(stage)), _element(std::move(element)) {}
+
+			std::string Explain(void) const { return _stage.Explain() + " -> Append"; }
+
+			template <typename Sink>
+			bool Run(Sink&& sink) const
+			{
+				return _stage.Run(sink) && sink(_element);
+			}
+
+		private:
+			Stage _stage;
+			value_type _element;
+		};
+
+		template <typename Stage, typename Stage_Second>
+		class Concat
+		{
+		public:
+			using value_type = typename Stage::value_type;
+
+			Concat(Stage first, Stage_Second second) : _first(std::move(first)), _second(std::move(second)) {}
+
+			std::string Explain(void) const { return "Concat(" + _first.Explain() + ", " + _second.Explain() + ")"; }
+
+			template <typename Sink>
+			bool Run(Sink&& sink) const
+			{
+				return _first.Run(sink) && _second.Run(sink);
+			}
+
+		private:
+			Stage _first;
+			Stage_Second _second;
+		};
+
+		// Reversing anything but a source needs the whole input first
+		template <typename Stage>
+		class Reverse
+		{
+		public:
+			using value_type = typename Stage::value_type;
+
+			explicit Reverse(Stage stage) : _stage(std::move(stage)) {}
+
+			const Stage& Inner(void) const { return _stage; }
+
+			std::string Explain(void) const { return _stage.Explain() + " -> Reverse(buffered)"; }
+
+			template <typename Sink>
+			bool Run(Sink&& sink) const
+			{
+				std::vector<value_type> _buffer;
+
+				_stage.Run([&](auto&& x)
+				{
+					_buffer.push_back(std::forward<decltype(x)>(x));
+					return true;
+				});
+
+				for (auto it = _buffer.rbegin(); it != _buffer.rend(); ++it)
+					if (!sink(std::move(*it)))
+						return false;
+
+				return true;
+			}
+
+		private:
+			Stage _stage;
+		};
+
+		// Sorts by key once run, stable like Enumerable<T>::OrderBy(). Every
+		// key selector runs once per element.
+		template <typename Stage, typename Function, typename Descending>
+		class OrderBy
+		{
+		public:
+			using value_type = typename Stage::value_type;
+
+			OrderBy(Stage stage, Function keySelector) : _stage(std::move(stage)), _keySelector(std::move(keySelector)) {}
+
+			const Stage& Inner(void) const { return _stage; }
+			const Function& KeySelector(void) const { return _keySelector; }
+
+			template <typename Sink>
+			bool Run(Sink&& sink) const
+			{
+				std::vector<value_type> _buffer;
+				std::vector<std::remove_cvref_t<std::invoke_result_t<const Function&, const value_type&>>> _keys;
+
+				_stage.Run([&](auto&& x)
+				{
+					_keys.push_back(_keySelector(x));
+					_buffer.push_back(std::forward<decltype(x)>(x));
+					return true;
+				});
+
+				std::vector<size_t> _order(_buffer.size());
+
+				for (size_t i = 0; i < _order.size(); i++)
+					_order[i] = i;
+				std::stable_sort(_order.begin(), _order.end(), [&](size_t i, size_t j)
+				{
+					return Descending::value ? _keys[j] < _keys[i] : _keys[i] < _keys[j];
+				});
+
+				for (auto i : _order)
+					if (!sink(std::move(_buffer[i])))
+						return false;
+
+				return true;
+			}
+
+			std::string Explain(void) const
+			{
+				return _stage.Explain() + (Descending::value ? " -> OrderByDescending" : " -> OrderBy") + "(buffered)";
+			}
+
+		private:
+			Stage _stage;
+			Function _keySelector;
+		};
+
+		// Passes every element on the first time it comes by, remembering the
+		// elements in an open-addressing KeyIndex. Large elements that are
+		// references into the source are remembered by address, anything
+		// else is copied into the index.
+		template <typename Stage>
+		class Distinct
+		{
+		public:
+			using value_type = typename Stage::value_type;
+
+			// Whether the elements are copied into the index
+			static constexpr bool CopiesElements = std::is_scalar_v<value_type> || !detail::BorrowsSource<Stage>::value;
+
+			explicit Distinct(Stage stage) : _stage(std::move(stage)) {}
+
+			template <typename Sink>
+			bool Run(Sink&& sink) const
+			{
+				return RunDistinct([&](auto&& x) { return sink(std::forward<decltype(x)>(x)); });
+			}
+
+			// Number of distinct elements, without passing any of them on
+			int Cardinality(void) const
+			{
+				auto _count = 0;
+
+				RunDistinct([&](const auto&) { _count++; return true; });
+
+				return _count;
+			}
+
+			std::string Explain(void) const { return _stage.Explain() + " -> Distinct"; }
+
+		private:
+			Stage _stage;
+
+			template <typename Sink>
+			bool RunDistinct(Sink&& sink) const
+			{
+				if constexpr (!CopiesElements)
+				{
+					using T_Hash = detail::IndirectHash<value_type, std::hash<value_type>>;
+					using T_Equal = detail::IndirectEqual<value_type, std::equal_to<value_type>>;
+
+					detail::KeyIndex<const value_type*, T_Hash, T_Equal> _seen;
+
+					return _stage.Run([&](const value_type& x) { return !_seen.Insert(&x).second || sink(x); });
+				}
+				else
+				{
+					detail::KeyIndex<value_type> _seen;
+
+					return _stage.Run([&](auto&& x)
+					{
+						return !_seen.Insert(std::as_const(x)).second || sink(std::forward<decltype(x)>(x));
+					});
+				}
+			}
+		};
+
+		// Measures the stage it wraps for a profiled query: the elements it
+		// passes on, its time and allocations and what of them was spent
+		// downstream, in the sink. The time spent downstream is sampled.
+		template <typename Stage>
+		class Probe
+		{
+		public:
+			using value_type = typename Stage::value_type;
+
+			Probe(Stage stage, profiling::Profiler* profiler, std::string name)
+				: _stage(std::move(stage)), _profiler(profiler), _name(std::move(name)) {}
+
+			std::string Explain(void) const { return _stage.Explain(); }
+
+			template <typename Sink>
+			bool Run(Sink&& sink) const
+			{
+				profiling::Scope _scope(*_profiler, _name.c_str(), detail::CopiedBytes<Stage>::input, detail::CopiedBytes<Stage>::output);
+
+				return _stage.Run([&](auto&& x)
+				{
+					auto _sampled = (*_profiler)[_scope.Id()].elementsOut++ % profiling::TIME_SAMPLING == 0;
+					auto _allocations = _profiler->Allocations();
+					auto _start = _sampled ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+					auto _continue = sink(std::forward<decltype(x)>(x));
+					auto _allocationsEnd = _profiler->Allocations();
+					auto& _record = (*_profiler)[_scope.Id()];
+
+					if (_sampled)
+					{
+						_record.downstream += std::chrono::steady_clock::now() - _start;
+						_record.downstreamSamples++;
+					}
+					_record.allocationsDownstream.count += _allocationsEnd.count - _allocations.count;
+					_record.allocationsDownstream.bytes += _allocationsEnd.bytes - _allocations.bytes;
+
+					return _continue;
+				});
+			}
+
+		private:
+			Stage _stage;
+			profiling::Profiler* _profiler;
+			std::string _name;
+		};
+	}  // namespace stages
+
+	namespace detail
+	{
+		template <typename T>
+		struct BorrowsSource<stages::Source<T>> : std::true_type {};
+
+		template <typename T>
+		struct BorrowsSource<stages::ReverseSource<T>> : std::true_type {};
+
+		// Stages that pass on what they get, or a part of it
+		template <typename Stage, typename Function>
+		struct BorrowsSource<stages::Where<Stage, Function>> : BorrowsSource<Stage> {};
+
+		template <typename Stage>
+		struct BorrowsSource<stages::Skip<Stage>> : BorrowsSource<Stage> {};
+
+		template <typename Stage>
+		struct BorrowsSource<stages::Take<Stage>> : BorrowsSource<Stage> {};
+
+		template <typename Stage, typename Function>
+		struct BorrowsSource<stages::SkipWhile<Stage, Function>> : BorrowsSource<Stage> {};
+
+		template <typename Stage, typename Function>
+		struct BorrowsSource<stages::TakeWhile<Stage, Function>> : BorrowsSource<Stage> {};
+
+		template <typename Stage>
+		struct BorrowsSource<stages::Distinct<Stage>> : BorrowsSource<Stage> {};
+
+		template <typename Stage>
+		struct BorrowsSource<stages::Probe<Stage>> : BorrowsSource<Stage> {};
+
+		// Stages that buffer what they get
+		template <typename Stage>
+		struct CopiedBytes<stages::Reverse<Stage>>
+		{
+			static constexpr size_t input = sizeof(typename Stage::value_type);
+			static constexpr size_t output = 0;
+		};
+
+		template <typename Stage, typename Function, typename Descending>
+		struct CopiedBytes<stages::OrderBy<Stage, Function, Descending>>
+		{
+			static constexpr size_t input = sizeof(typename Stage::value_type);
+			static constexpr size_t output = 0;
+		};
+
+		template <typename Stage>
+		struct CopiedBytes<stages::Distinct<Stage>>
+		{
+			static constexpr size_t input = 0;
+			static constexpr size_t output = stages::Distinct<Stage>::CopiesElements ? sizeof(typename Stage::value_type) : 0;
+		};
+	}  // namespace detail
+
+	// Terminal operation whose plan Query<Stage>::Explain() describes
+	enum class Terminal { None, Count, First, Last };
+
+	// Lazily evaluated operator chain, created by Enumerable<T>::AsLazy().
+	// Operators only compose stages; nothing is evaluated or allocated until
+	// a terminal operation (ToVector(), foreach(), Count(), ...) runs the chain.
+	// A Query borrows the data of the Enumerable it was created from, which
+	// therefore has to outlive it.
+	// The stage types are the query plan, and operators rewrite it as they
+	// compose: Where() after Where() tests both predicates in one stage and
+	// Skip()/Take() on a source slice it. Terminal operations pick the
+	// cheapest plan for their result: Count() ignores Select(), Reverse()
+	// and OrderBy() and counts a Distinct() in a hash set alone, First() and
+	// Last() swap over a Reverse() and find the extreme key of an OrderBy()
+	// in one scan. Explain() shows the plan that is left.
+	// Profile() switches the Policy to profiling::Enabled, under which every
+	// operator is measured on its own and no plan is rewritten. Queries that
+	// are not profiled are built from the bare stages as before.
+	template <typename Stage, typename Policy = profiling::Disabled>
+	class Query
+	{
+	public:
+		using value_type = typename Stage::value_type;
+
+		explicit Query(Stage stage, Policy policy = Policy()) : _stage(std::move(stage)), _policy(policy) {}
+
+		// Measures every operator from here on and reports to 'profiler'
+		// after every terminal operation; the stages so far count as one
+		// operator. The profiler has to outlive the query.
+		auto Profile(profiling::Profiler& profiler) const requires (!Policy::enabled)
+		{
+			return Query<stages::Probe<Stage>, profiling::Enabled>(stages::Probe<Stage>(_stage, &profiler, _stage.Explain()), { &profiler });
+		}
+
+		template <Predicate<value_type> Function>
+		auto Where(Function predicate) const
+		{
+			if constexpr (detail::IsStage<Stage, stages::Where>::value)
+			{
+				using T_Inner = std::remove_cvref_t<decltype(_stage.Inner())>;
+				using T_Predicate = detail::Conjunction<std::remove_cvref_t<decltype(_stage.Condition())>, Function>;
+
+				return Query<stages::Where<T_Inner, T_Predicate>>({ _stage.Inner(), T_Predicate{ _stage.Condition(), std::move(predicate) } });
+			}
+			else
+				return Chain(stages::Where<Stage, Function>{ _stage, std::move(predicate) }, "Where");
+		}
+
+		template <Selector<value_type> Function>
+		auto Select(Function selector) const
+		{
+			return Chain(stages::Select<Stage, Function>{ _stage, std::move(selector) }, "Select");
+		}
+
+		// Walks a source backwards without copying it, or a reversed one
+		// forwards again; other stages are buffered
+		auto Reverse(void) const
+		{
+			if constexpr (IsSource())
+				return Query<std::remove_cvref_t<decltype(_stage.Reversed())>>(_stage.Reversed());
+			else
+				return Chain(stages::Reverse<Stage>(_stage), "Reverse");
+		}
+
+		auto Skip(int count) const
+		{
+			if constexpr (IsSource())
+				return Query(_stage.Slice(size_t(std::max(count, 0)), _stage.Size()));
+			else
+				return Chain(stages::Skip<Stage>{ _stage, count }, "Skip");
+		}
+
+		auto Take(int count) const
+		{
+			if constexpr (IsSource())
+				return Query(_stage.Slice(0, size_t(std::max(count, 0))));
+			else
+				return Chain(stages::Take<Stage>{ _stage, count }, "Take");
+		}
+
+		template <typename Function>
+			requires Predicate<Function, value_type> || IndexedPredicate<Function, value_type>
+		auto SkipWhile(Function predicate) const
+		{
+			return Chain(stages::SkipWhile<Stage, Function>{ _stage, std::move(predicate) }, "SkipWhile");
+		}
+
+		template <typename Function>
+			requires Predicate<Function, value_type> || IndexedPredicate<Function, value_type>
+		auto TakeWhile(Function predicate) const
+		{
+			return Chain(stages::TakeWhile<Stage, Function>{ _stage, std::move(predicate) }, "TakeWhile");
+		}
+
+		auto Prepend(value_type element) const
+		{
+			return Chain(stages::Prepend<Stage>{ _stage, std::move(element) }, "Prepend");
+		}
+
+		auto Append(value_type element) const
+		{
+			return Chain(stages::Append<Stage>{ _stage, std::move(element) }, "Append");
+		}
+
+		template <typename Stage_Second, typename Policy_Second>
+		auto Concat(const Query<Stage_Second, Policy_Second>& second) const
+		{
+			return Chain(stages::Concat<Stage, Stage_Second>{ _stage, second._stage }, "Concat");
+		}
+
+		// Passes on every element the first time it comes by
+		auto Distinct(void) const requires Hashable<value_type>
+		{
+			return Chain(stages::Distinct<Stage>(_stage), "Distinct");
+		}
+
+		// Sorts by key once run, stable like Enumerable<T>::OrderBy()
+		template <Selector<value_type> Function>
+		auto OrderBy(Function keySelector) const
+		{
+			return Chain(stages::OrderBy<Stage, Function, std::false_type>{ _stage, std::move(keySelector) }, "OrderBy");
+		}
+
+		template <Selector<value_type> Function>
+		auto OrderByDescending(Function keySelector) const
+		{
+			return Chain(stages::OrderBy<Stage, Function, std::true_type>{ _stage, std::move(keySelector) }, "OrderByDescending");
+		}
+
+		template <Accumulator<value_type> Function>
+		auto Aggregate(value_type seed, Function func) const
+		{
+			return Measure("Aggregate", 0, [&]
+			{
+				auto _aggregate = std::move(seed);
+
+				foreach([&](const value_type& x) { _aggregate = func(_aggregate, x); });
+
+				return _aggregate;
+			});
+		}
+
+		template <Predicate<value_type> Function>
+		auto All(Function predicate) const
+		{
+			return Measure("All", 0, [&] { return _stage.Run([&](const value_type& x) { return bool(predicate(x)); }); });
+		}
+
+		auto Any(void) const
+		{
+			return Measure("Any", 0, [&] { return !_stage.Run([](const value_type&) { return false; }); });
+		}
+
+		template <Predicate<value_type> Function>
+		auto Any(Function predicate) const
+		{
+			return Measure("Any", 0, [&] { return !_stage.Run([&](const value_type& x) { return !predicate(x); }); });
+		}
+
+		// Estimated number of distinct elements in 2^precision bytes
+		size_t ApproxCountDistinct(int precision = 12) const requires Hashable<value_type>
+		{
+			return Measure("ApproxCountDistinct", 0, [&]
+			{
+				sketches::HyperLogLog<value_type> _sketch(precision);
+
+				foreach([&](const value_type& x) { _sketch.Add(x); });
+
+				return size_t(std::llround(_sketch.Estimate()));
+			});
+		}
+
+		// Estimated 'q'-quantile, from a sketch of about 3k elements
+		value_type ApproxQuantile(double q, int k = 200) const requires Ordered<value_type>
+		{
+			if (!(q >= 0 && q <= 1))
+				throw std::out_of_range("Query<T>::ApproxQuantile() : 'q' is not in [0, 1]");
+
+			return Measure("ApproxQuantile", 0, [&]
+			{
+				sketches::QuantileSketch<value_type> _sketch(k);
+
+				foreach([&](const value_type& x) { _sketch.Add(x); });
+
+				if (_sketch.Count() == 0)
+					throw std::runtime_error("Query<T>::ApproxQuantile() : The source sequence is empty");
+
+				return _sketch.Quantile(q);
+			});
+		}
+
+		// See Enumerable<T>::Average()
+		template <std::floating_point T_Result = float>
+		T_Result Average(Summation summation = Summation::Naive) const requires Arithmetic<value_type>
+		{
+			return Measure("Average", 0, [&]
+			{
+				size_t _count = 0;
+				auto _sum = summation::Accumulate<summation::Wide<value_type>>(summation, [&](auto add)
+				{
+					foreach([&](const value_type& x) { add(x); _count++; });
+				});
+
+				return summation::Mean<T_Result>(_sum, _count);
+			});
+		}
+
+		auto Contains(const value_type& item) const
+		{
+			return Measure("Contains", 0, [&] { return !_stage.Run([&](const value_type& x) { return !(x == item); }); });
+		}
+
+		int Count(void) const
+		{
+			if constexpr (CountsInner())
+				return Query<std::remove_cvref_t<decltype(_stage.Inner())>>(_stage.Inner()).Count();
+			else if constexpr (IsSource())
+				return int(_stage.Size());
+			else if constexpr (detail::IsStage<Stage, stages::Distinct>::value)
+				return _stage.Cardinality();
+			else
+			{
+				return Measure("Count", 0, [&]
+				{
+					auto _count = 0;
+
+					_stage.Run([&](const value_type&) { _count++; return true; });
+
+					return _count;
+				});
+			}
+		}
+
+		auto First(void) const
+		{
+			if constexpr (detail::IsStage<Stage, stages::Reverse>::value)
+				return Query<std::remove_cvref_t<decltype(_stage.Inner())>>(_stage.Inner()).Last();
+			else if constexpr (IsSource())
+				return Front("First");
+			else if constexpr (detail::IsStage<Stage, stages::OrderBy>::value)
+				return Extreme(Descending(), false, "First");
+			else
+				return Measure("First", 0, [&] { return Scan(true, "First"); });
+		}
+
+		// Runs the whole chain, unless the plan has a shortcut to its end
+		auto Last(void) const
+		{
+			if constexpr (detail::IsStage<Stage, stages::Reverse>::value)
+				return Query<std::remove_cvref_t<decltype(_stage.Inner())>>(_stage.Inner()).First();
+			else if constexpr (IsSource())
+				return Query<std::remove_cvref_t<decltype(_stage.Reversed())>>(_stage.Reversed()).Front("Last");
+			else if constexpr (detail::IsStage<Stage, stages::Select>::value)
+				return value_type(_stage.Projection()(Query<std::remove_cvref_t<decltype(_stage.Inner())>>(_stage.Inner()).Last()));
+			else if constexpr (detail::IsStage<Stage, stages::OrderBy>::value)
+				return Extreme(!Descending(), true, "Last");
+			else
+				return Measure("Last", 0, [&] { return Scan(false, "Last"); });
+		}
+
+		// The plan 'terminal' would run, the stages from the source on
+		std::string Explain(Terminal terminal = Terminal::None) const
+		{
+			switch (terminal)
+			{
+			case Terminal::Count:
+				if constexpr (CountsInner())
+					return Query<std::remove_cvref_t<decltype(_stage.Inner())>>(_stage.Inner()).Explain(terminal);
+				else if constexpr (IsSource())
+					return _stage.Explain() + " -> Count(size)";
+				else if constexpr (detail::IsStage<Stage, stages::Distinct>::value)
+					return _stage.Explain() + " -> Count(hash cardinality)";
+				else
+					return _stage.Explain() + " -> Count";
+			case Terminal::First:
+				if constexpr (detail::IsStage<Stage, stages::Reverse>::value)
+					return Query<std::remove_cvref_t<decltype(_stage.Inner())>>(_stage.Inner()).Explain(Terminal::Last);
+				else if constexpr (detail::IsStage<Stage, stages::OrderBy>::value)
+					return _stage.Inner().Explain() + (Descending() ? " -> MaxBy" : " -> MinBy");
+				else
+					return _stage.Explain() + " -> First";
+			case Terminal::Last:
+				if constexpr (detail::IsStage<Stage, stages::Reverse>::value)
+					return Query<std::remove_cvref_t<decltype(_stage.Inner())>>(_stage.Inner()).Explain(Terminal::First);
+				else if constexpr (IsSource())
+					return _stage.Reversed().Explain() + " -> First";
+				else if constexpr (detail::IsStage<Stage, stages::Select>::value)
+					return Query<std::remove_cvref_t<decltype(_stage.Inner())>>(_stage.Inner()).Explain(Terminal::Last) + " -> Select";
+				else if constexpr (detail::IsStage<Stage, stages::OrderBy>::value)
+					return _stage.Inner().Explain() + (Descending() ? " -> LastMinBy" : " -> LastMaxBy");
+				else
+					return _stage.Explain() + " -> Last";
+			default:
+				return _stage.Explain();
+			}
+		}
+
+		// See Enumerable<T>::Sum()
+		template <typename T_Sum = value_type>
+		auto Sum(Summation summation = Summation::Naive) const
+		{
+			return Measure("Sum", 0, [&]
+			{
+				return summation::Accumulate<T_Sum>(summation, [&](auto add) { foreach(add); });
+			});
+		}
+
+		auto ToVector(void) const
+		{
+			return Measure("ToVector", sizeof(value_type), [&]
+			{
+				std::vector<value_type> _newVec;
+
+				_stage.Run([&](auto&& x)
+				{
+					_newVec.push_back(std::forward<decltype(x)>(x));
+					return true;
+				});
+
+				return _newVec;
+			});
+		}
+
+		auto ToEnumerable(void) const { return Enumerable<value_type, 0, std::allocator<value_type>>(ToVector()); }
+
+		// The 'k' most frequent elements with their estimated counts, from
+		// 'capacity' counters, 10 per element unless given
+		auto TopKFrequent(int k, int capacity = 0) const requires Hashable<value_type>
+		{
+			if (k <= 0)
+				throw std::out_of_range("Query<T>::TopKFrequent() : 'k' is less than 1");
+
+			return Measure("TopKFrequent", 0, [&]
+			{
+				sketches::HeavyHitters<value_type> _sketch(capacity > 0 ? capacity : 10 * k);
+
+				foreach([&](const value_type& x) { _sketch.Add(x); });
+
+				return _sketch.Top(k);
+			});
+		}
+
+		template <typename Function>
+		void foreach(Function func) const
+		{
+			Measure("foreach", 0, [&]
+			{
+				_stage.Run([&](auto&& x)
+				{
+					func(std::forward<decltype(x)>(x));
+					return true;
+				});
+			});
+		}
+
+		// Collects the elements into blocks of 'size' and calls 'func' with
+		// each as a std::span<const T>, the last one possibly shorter. The
+		// block buffer is reused, so a span is only valid during its call.
+		template <std::invocable<std::span<const value_type>> Function>
+		void foreachBatch(int size, Function func) const
+		{
+			if (size <= 0)
+				throw std::out_of_range("Query<T>::foreachBatch() : 'size' is less than 1");
+
+			Measure("foreachBatch", sizeof(value_type), [&]
+			{
+				std::vector<value_type> _batch;
+
+				_batch.reserve(size);
+				_stage.Run([&](auto&& x)
+				{
+					_batch.push_back(std::forward<decltype(x)>(x));
+					if (_batch.size() == size_t(size))
+					{
+						func(std::span<const value_type>(_batch));
+						_batch.clear();
+					}
+					return true;
+				});
+
+				if (!_batch.empty())
+					func(std::span<const value_type>(_batch));
+			});
+		}
+
+		template <std::invocable<std::span<const value_type>> Function>
+		void foreachBatch(Function func) const { foreachBatch(BATCH_SIZE<value_type>, func); }
+
+	private:
+		Stage _stage;
+		[[no_unique_address]] Policy _policy;
+
+		template <typename Stage_Other, typename Policy_Other>
+		friend class Query;
+
+		// The query with 'stage' appended, measured on its own if profiled
+		template <typename T_Stage>
+		auto Chain(T_Stage stage, const char* name) const
+		{
+			if constexpr (Policy::enabled)
+				return Query<stages::Probe<T_Stage>, Policy>(stages::Probe<T_Stage>(std::move(stage), _policy.profiler, name), _policy);
+			else
+				return Query<T_Stage>(std::move(stage));
+		}
+
+		// Runs the terminal operation 'func' as the last operator of a
+		// profiled query, or as is. Terminals that call other terminals
+		// are measured once.
+		template <typename Function>
+		decltype(auto) Measure(const char* name, size_t bytesPerInput, Function func) const
+		{
+			if constexpr (Policy::enabled)
+			{
+				if (!_policy.profiler->Running())
+				{
+					profiling::Scope _scope(*_policy.profiler, name, bytesPerInput);
+
+					return func();
+				}
+			}
+
+			return func();
+		}
+
+		static constexpr bool IsSource(void)
+		{
+			return detail::IsStage<Stage, stages::Source>::value || detail::IsStage<Stage, stages::ReverseSource>::value;
+		}
+
+		// Stages that keep the number of elements
+		static constexpr bool CountsInner(void)
+		{
+			return detail::IsStage<Stage, stages::Select>::value || detail::IsStage<Stage, stages::Reverse>::value
+				|| detail::IsStage<Stage, stages::OrderBy>::value;
+		}
+
+		static constexpr bool Descending(void)
+		{
+			if constexpr (detail::IsStage<Stage, stages::OrderBy>::value)
+				return decltype(OrderDirection(std::declval<Stage>()))::value;
+			else
+				return false;
+		}
+
+		template <typename S, typename F, typename D>
+		static D OrderDirection(const stages::OrderBy<S, F, D>&);
+
+		value_type Front(const char* _mName) const
+		{
+			if (_stage.Size() == 0)
+				throw std::runtime_error(std::string("Query<T>::") + _mName + "() : The source sequence is empty");
+
+			return _stage[0];
+		}
+
+		// Keeps the first element when 'first', the last one otherwise
+		value_type Scan(bool first, const char* _mName) const
+		{
+			std::optional<value_type> _element;
+
+			_stage.Run([&](auto&& x)
+			{
+				_element.emplace(std::forward<decltype(x)>(x));
+				return !first;
+			});
+
+			if (!_element)
+				throw std::runtime_error(std::string("Query<T>::") + _mName + "() : The source sequence is empty");
+
+			return std::move(*_element);
+		}
+
+		// The element with the largest key when 'largest', the smallest one
+		// otherwise. Ties go to the first such element, or the 'last' one,
+		// which is where the stable sort would put them.
+		value_type Extreme(bool largest, bool last, const char* _mName) const
+		{
+			using T_Key = std::remove_cvref_t<std::invoke_result_t<decltype(_stage.KeySelector()), const value_type&>>;
+
+			std::optional<value_type> _element;
+			std::optional<T_Key> _key;
+
+			_stage.Inner().Run([&](auto&& x)
+			{
+				auto _next = _stage.KeySelector()(x);
+
+				if (!_key || (largest ? *_key < _next : _next < *_key) || (last && !(*_key < _next) && !(_next < *_key)))
+				{
+					_key.emplace(std::move(_next));
+					_element.emplace(std::forward<decltype(x)>(x));
+				}
+				return true;
+			});
+
+			if (!_element)
+				throw std::runtime_error(std::string("Query<T>::") + _mName + "() : The source sequence is empty");
+
+			return std::move(*_element);
+		}
+	};
+}  // namespace linq
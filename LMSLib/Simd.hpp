@@ -0,0 +1,647 @@
+#pragma once
+
+#include <concepts>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+#include "macros.hpp"
+#include "Summation.hpp"
+
+#if LMS_X86_
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+namespace linq
+{
+	// Explicitly vectorized reductions over contiguous data with a runtime
+	// choice between AVX2, SSE2 and a scalar fallback.
+	namespace simd
+	{
+		template <typename T>
+		concept Vectorizable = (std::signed_integral<T> && (sizeof(T) == 4 || sizeof(T) == 8))
+			|| std::is_same_v<T, float> || std::is_same_v<T, double>;
+
+		// Accumulators with vectorized kernels for T: T itself, 64-bit
+		// integers for 32-bit ones and double for float
+		template <typename T_Sum, typename T>
+		concept Accumulable = Vectorizable<T> && (std::is_same_v<T_Sum, T>
+			|| (std::signed_integral<T> && sizeof(T) == 4 && std::signed_integral<T_Sum> && sizeof(T_Sum) == 8)
+			|| (std::is_same_v<T, float> && std::is_same_v<T_Sum, double>));
+
+		enum class Level { Scalar, SSE2, AVX2 };
+
+		inline Level detectLevel(void)
+		{
+#if LMS_X86_ && defined(_MSC_VER)
+			int _info[4];
+
+			__cpuid(_info, 0);
+			if (_info[0] >= 7)
+			{
+				__cpuid(_info, 1);
+				auto _osxsave = (_info[2] & (1 << 27)) != 0;
+
+				__cpuidex(_info, 7, 0);
+				if ((_info[1] & (1 << 5)) != 0 && _osxsave && (_xgetbv(0) & 6) == 6)
+					return Level::AVX2;
+			}
+			return Level::SSE2;
+#elif LMS_X86_
+			__builtin_cpu_init();
+			if (__builtin_cpu_supports("avx2"))
+				return Level::AVX2;
+			if (__builtin_cpu_supports("sse2"))
+				return Level::SSE2;
+			return Level::Scalar;
+#else
+			return Level::Scalar;
+#endif
+		}
+
+		// The best level supported by this CPU, detected once
+		inline Level level(void)
+		{
+			static const auto _level = detectLevel();
+			return _level;
+		}
+
+		namespace detail
+		{
+			template <typename T, typename T_Sum = T>
+			T_Sum sumScalar(const T* data, size_t size, size_t start = 0, T_Sum sum = T_Sum())
+			{
+				for (size_t i = start; i < size; i++)
+					sum = summation::add(sum, static_cast<T_Sum>(data[i]));
+
+				return sum;
+			}
+
+			template <typename T_Sum, typename T>
+			T_Sum sumCompensatedScalar(const T* data, size_t size, size_t start = 0, summation::Compensated<T_Sum> sum = {})
+			{
+				for (size_t i = start; i < size; i++)
+					sum.Add(static_cast<T_Sum>(data[i]));
+
+				return sum.Value();
+			}
+
+			template <typename T>
+			std::pair<T, T> minMaxScalar(const T* data, size_t size, size_t start, std::pair<T, T> minMax)
+			{
+				for (size_t i = start; i < size; i++)
+				{
+					if (data[i] < minMax.first)
+						minMax.first = data[i];
+					if (minMax.second < data[i])
+						minMax.second = data[i];
+				}
+
+				return minMax;
+			}
+
+			template <typename T>
+			std::pair<T, T> minMaxScalar(const T* data, size_t size)
+			{
+				return minMaxScalar(data, size, 1, { data[0], data[0] });
+			}
+
+#if LMS_X86_
+			// Four independent accumulators hide the latency of the vector adds
+			template <typename T>
+			LMS_TARGET_SSE2_ T sumSse2(const T* data, size_t size)
+			{
+				constexpr size_t lanes = 16 / sizeof(T);
+				alignas(16) T _partial[lanes];
+				size_t i = 0;
+
+				if constexpr (std::is_same_v<T, float>)
+				{
+					auto _a0 = _mm_setzero_ps(), _a1 = _a0, _a2 = _a0, _a3 = _a0;
+					for (; i + 4 * lanes <= size; i += 4 * lanes)
+					{
+						_a0 = _mm_add_ps(_a0, _mm_loadu_ps(data + i));
+						_a1 = _mm_add_ps(_a1, _mm_loadu_ps(data + i + lanes));
+						_a2 = _mm_add_ps(_a2, _mm_loadu_ps(data + i + 2 * lanes));
+						_a3 = _mm_add_ps(_a3, _mm_loadu_ps(data + i + 3 * lanes));
+					}
+					_a0 = _mm_add_ps(_mm_add_ps(_a0, _a1), _mm_add_ps(_a2, _a3));
+					for (; i + lanes <= size; i += lanes)
+						_a0 = _mm_add_ps(_a0, _mm_loadu_ps(data + i));
+					_mm_store_ps(_partial, _a0);
+				}
+				else if constexpr (std::is_same_v<T, double>)
+				{
+					auto _a0 = _mm_setzero_pd(), _a1 = _a0, _a2 = _a0, _a3 = _a0;
+					for (; i + 4 * lanes <= size; i += 4 * lanes)
+					{
+						_a0 = _mm_add_pd(_a0, _mm_loadu_pd(data + i));
+						_a1 = _mm_add_pd(_a1, _mm_loadu_pd(data + i + lanes));
+						_a2 = _mm_add_pd(_a2, _mm_loadu_pd(data + i + 2 * lanes));
+						_a3 = _mm_add_pd(_a3, _mm_loadu_pd(data + i + 3 * lanes));
+					}
+					_a0 = _mm_add_pd(_mm_add_pd(_a0, _a1), _mm_add_pd(_a2, _a3));
+					for (; i + lanes <= size; i += lanes)
+						_a0 = _mm_add_pd(_a0, _mm_loadu_pd(data + i));
+					_mm_store_pd(_partial, _a0);
+				}
+				else
+				{
+					auto _a0 = _mm_setzero_si128();
+					for (; i + lanes <= size; i += lanes)
+					{
+						auto _x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+						_a0 = sizeof(T) == 4 ? _mm_add_epi32(_a0, _x) : _mm_add_epi64(_a0, _x);
+					}
+					_mm_store_si128(reinterpret_cast<__m128i*>(_partial), _a0);
+				}
+
+				return sumScalar(data, size, i, sumScalar(_partial, lanes));
+			}
+
+			template <typename T>
+			LMS_TARGET_AVX2_ T sumAvx2(const T* data, size_t size)
+			{
+				constexpr size_t lanes = 32 / sizeof(T);
+				alignas(32) T _partial[lanes];
+				size_t i = 0;
+
+				if constexpr (std::is_same_v<T, float>)
+				{
+					auto _a0 = _mm256_setzero_ps(), _a1 = _a0, _a2 = _a0, _a3 = _a0;
+					for (; i + 4 * lanes <= size; i += 4 * lanes)
+					{
+						_a0 = _mm256_add_ps(_a0, _mm256_loadu_ps(data + i));
+						_a1 = _mm256_add_ps(_a1, _mm256_loadu_ps(data + i + lanes));
+						_a2 = _mm256_add_ps(_a2, _mm256_loadu_ps(data + i + 2 * lanes));
+						_a3 = _mm256_add_ps(_a3, _mm256_loadu_ps(data + i + 3 * lanes));
+					}
+					_a0 = _mm256_add_ps(_mm256_add_ps(_a0, _a1), _mm256_add_ps(_a2, _a3));
+					for (; i + lanes <= size; i += lanes)
+						_a0 = _mm256_add_ps(_a0, _mm256_loadu_ps(data + i));
+					_mm256_store_ps(_partial, _a0);
+				}
+				else if constexpr (std::is_same_v<T, double>)
+				{
+					auto _a0 = _mm256_setzero_pd(), _a1 = _a0, _a2 = _a0, _a3 = _a0;
+					for (; i + 4 * lanes <= size; i += 4 * lanes)
+					{
+						_a0 = _mm256_add_pd(_a0, _mm256_loadu_pd(data + i));
+						_a1 = _mm256_add_pd(_a1, _mm256_loadu_pd(data + i + lanes));
+						_a2 = _mm256_add_pd(_a2, _mm256_loadu_pd(data + i + 2 * lanes));
+						_a3 = _mm256_add_pd(_a3, _mm256_loadu_pd(data + i + 3 * lanes));
+					}
+					_a0 = _mm256_add_pd(_mm256_add_pd(_a0, _a1), _mm256_add_pd(_a2, _a3));
+					for (; i + lanes <= size; i += lanes)
+						_a0 = _mm256_add_pd(_a0, _mm256_loadu_pd(data + i));
+					_mm256_store_pd(_partial, _a0);
+				}
+				else
+				{
+					auto _a0 = _mm256_setzero_si256(), _a1 = _a0;
+					for (; i + 2 * lanes <= size; i += 2 * lanes)
+					{
+						auto _x0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+						auto _x1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + lanes));
+						_a0 = sizeof(T) == 4 ? _mm256_add_epi32(_a0, _x0) : _mm256_add_epi64(_a0, _x0);
+						_a1 = sizeof(T) == 4 ? _mm256_add_epi32(_a1, _x1) : _mm256_add_epi64(_a1, _x1);
+					}
+					_a0 = sizeof(T) == 4 ? _mm256_add_epi32(_a0, _a1) : _mm256_add_epi64(_a0, _a1);
+					_mm256_store_si256(reinterpret_cast<__m256i*>(_partial), _a0);
+				}
+
+				return sumScalar(data, size, i, sumScalar(_partial, lanes));
+			}
+
+			// 32-bit integers into 64-bit lanes and floats into doubles, which
+			// SSE2 has to sign extend and convert by hand
+			template <typename T_Sum, typename T>
+			LMS_TARGET_SSE2_ T_Sum sumWideSse2(const T* data, size_t size)
+			{
+				constexpr size_t lanes = 16 / sizeof(T);
+				alignas(16) T_Sum _partial[lanes];
+				size_t i = 0;
+
+				if constexpr (std::is_same_v<T, float>)
+				{
+					auto _a0 = _mm_setzero_pd(), _a1 = _a0, _a2 = _a0, _a3 = _a0;
+					for (; i + 2 * lanes <= size; i += 2 * lanes)
+					{
+						auto _x0 = _mm_loadu_ps(data + i);
+						auto _x1 = _mm_loadu_ps(data + i + lanes);
+						_a0 = _mm_add_pd(_a0, _mm_cvtps_pd(_x0));
+						_a1 = _mm_add_pd(_a1, _mm_cvtps_pd(_mm_movehl_ps(_x0, _x0)));
+						_a2 = _mm_add_pd(_a2, _mm_cvtps_pd(_x1));
+						_a3 = _mm_add_pd(_a3, _mm_cvtps_pd(_mm_movehl_ps(_x1, _x1)));
+					}
+					_mm_store_pd(_partial, _mm_add_pd(_a0, _a2));
+					_mm_store_pd(_partial + 2, _mm_add_pd(_a1, _a3));
+				}
+				else
+				{
+					auto _a0 = _mm_setzero_si128(), _a1 = _a0;
+					for (; i + lanes <= size; i += lanes)
+					{
+						auto _x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+						auto _sign = _mm_srai_epi32(_x, 31);
+						_a0 = _mm_add_epi64(_a0, _mm_unpacklo_epi32(_x, _sign));
+						_a1 = _mm_add_epi64(_a1, _mm_unpackhi_epi32(_x, _sign));
+					}
+					_mm_store_si128(reinterpret_cast<__m128i*>(_partial), _a0);
+					_mm_store_si128(reinterpret_cast<__m128i*>(_partial + 2), _a1);
+				}
+
+				return sumScalar(data, size, i, sumScalar(_partial, lanes));
+			}
+
+			template <typename T_Sum, typename T>
+			LMS_TARGET_AVX2_ T_Sum sumWideAvx2(const T* data, size_t size)
+			{
+				constexpr size_t lanes = 32 / sizeof(T_Sum);
+				alignas(32) T_Sum _partial[lanes];
+				size_t i = 0;
+
+				if constexpr (std::is_same_v<T, float>)
+				{
+					auto _a0 = _mm256_setzero_pd(), _a1 = _a0, _a2 = _a0, _a3 = _a0;
+					for (; i + 4 * lanes <= size; i += 4 * lanes)
+					{
+						_a0 = _mm256_add_pd(_a0, _mm256_cvtps_pd(_mm_loadu_ps(data + i)));
+						_a1 = _mm256_add_pd(_a1, _mm256_cvtps_pd(_mm_loadu_ps(data + i + lanes)));
+						_a2 = _mm256_add_pd(_a2, _mm256_cvtps_pd(_mm_loadu_ps(data + i + 2 * lanes)));
+						_a3 = _mm256_add_pd(_a3, _mm256_cvtps_pd(_mm_loadu_ps(data + i + 3 * lanes)));
+					}
+					_mm256_store_pd(_partial, _mm256_add_pd(_mm256_add_pd(_a0, _a1), _mm256_add_pd(_a2, _a3)));
+				}
+				else
+				{
+					auto _a0 = _mm256_setzero_si256(), _a1 = _a0;
+					for (; i + 2 * lanes <= size; i += 2 * lanes)
+					{
+						_a0 = _mm256_add_epi64(_a0, _mm256_cvtepi32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i))));
+						_a1 = _mm256_add_epi64(_a1, _mm256_cvtepi32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + lanes))));
+					}
+					_mm256_store_si256(reinterpret_cast<__m256i*>(_partial), _mm256_add_epi64(_a0, _a1));
+				}
+
+				return sumScalar(data, size, i, sumScalar(_partial, lanes));
+			}
+
+			// One step of Summation::Compensated in every lane. SSE2 has no
+			// blend, so the larger and smaller operands are masked together.
+			LMS_TARGET_SSE2_ inline void neumaierSse2(__m128d& sum, __m128d& compensation, __m128d x)
+			{
+				auto _sign = _mm_set1_pd(-0.0);
+				auto _next = _mm_add_pd(sum, x);
+				auto _keep = _mm_cmpge_pd(_mm_andnot_pd(_sign, sum), _mm_andnot_pd(_sign, x));
+				auto _larger = _mm_or_pd(_mm_and_pd(_keep, sum), _mm_andnot_pd(_keep, x));
+				auto _smaller = _mm_or_pd(_mm_and_pd(_keep, x), _mm_andnot_pd(_keep, sum));
+				compensation = _mm_add_pd(compensation, _mm_add_pd(_mm_sub_pd(_larger, _next), _smaller));
+				sum = _next;
+			}
+
+			LMS_TARGET_SSE2_ inline void neumaierSse2(__m128& sum, __m128& compensation, __m128 x)
+			{
+				auto _sign = _mm_set1_ps(-0.0f);
+				auto _next = _mm_add_ps(sum, x);
+				auto _keep = _mm_cmpge_ps(_mm_andnot_ps(_sign, sum), _mm_andnot_ps(_sign, x));
+				auto _larger = _mm_or_ps(_mm_and_ps(_keep, sum), _mm_andnot_ps(_keep, x));
+				auto _smaller = _mm_or_ps(_mm_and_ps(_keep, x), _mm_andnot_ps(_keep, sum));
+				compensation = _mm_add_ps(compensation, _mm_add_ps(_mm_sub_ps(_larger, _next), _smaller));
+				sum = _next;
+			}
+
+			LMS_TARGET_AVX2_ inline void neumaierAvx2(__m256d& sum, __m256d& compensation, __m256d x)
+			{
+				auto _sign = _mm256_set1_pd(-0.0);
+				auto _next = _mm256_add_pd(sum, x);
+				auto _keep = _mm256_cmp_pd(_mm256_andnot_pd(_sign, sum), _mm256_andnot_pd(_sign, x), _CMP_GE_OQ);
+				auto _larger = _mm256_blendv_pd(x, sum, _keep);
+				auto _smaller = _mm256_blendv_pd(sum, x, _keep);
+				compensation = _mm256_add_pd(compensation, _mm256_add_pd(_mm256_sub_pd(_larger, _next), _smaller));
+				sum = _next;
+			}
+
+			LMS_TARGET_AVX2_ inline void neumaierAvx2(__m256& sum, __m256& compensation, __m256 x)
+			{
+				auto _sign = _mm256_set1_ps(-0.0f);
+				auto _next = _mm256_add_ps(sum, x);
+				auto _keep = _mm256_cmp_ps(_mm256_andnot_ps(_sign, sum), _mm256_andnot_ps(_sign, x), _CMP_GE_OQ);
+				auto _larger = _mm256_blendv_ps(x, sum, _keep);
+				auto _smaller = _mm256_blendv_ps(sum, x, _keep);
+				compensation = _mm256_add_ps(compensation, _mm256_add_ps(_mm256_sub_ps(_larger, _next), _smaller));
+				sum = _next;
+			}
+
+			// The lanes are merged into one scalar sum with their compensations
+			template <typename T_Sum>
+			summation::Compensated<T_Sum> mergeLanes(const T_Sum* sums, const T_Sum* compensations, size_t lanes)
+			{
+				summation::Compensated<T_Sum> _sum;
+
+				for (size_t i = 0; i < lanes; i++)
+					_sum.Merge({ sums[i], compensations[i] });
+
+				return _sum;
+			}
+
+			// Two sets of accumulators, because every step waits on the
+			// previous sum
+			template <typename T_Sum, typename T>
+			LMS_TARGET_SSE2_ T_Sum sumCompensatedSse2(const T* data, size_t size)
+			{
+				constexpr size_t lanes = 16 / sizeof(T_Sum);
+				alignas(16) T_Sum _sums[2 * lanes];
+				alignas(16) T_Sum _compensations[2 * lanes];
+				size_t i = 0;
+
+				if constexpr (std::is_same_v<T_Sum, float>)
+				{
+					auto _s0 = _mm_setzero_ps(), _s1 = _s0, _c0 = _s0, _c1 = _s0;
+					for (; i + 2 * lanes <= size; i += 2 * lanes)
+					{
+						neumaierSse2(_s0, _c0, _mm_loadu_ps(data + i));
+						neumaierSse2(_s1, _c1, _mm_loadu_ps(data + i + lanes));
+					}
+					_mm_store_ps(_sums, _s0);
+					_mm_store_ps(_sums + lanes, _s1);
+					_mm_store_ps(_compensations, _c0);
+					_mm_store_ps(_compensations + lanes, _c1);
+				}
+				else
+				{
+					auto _s0 = _mm_setzero_pd(), _s1 = _s0, _c0 = _s0, _c1 = _s0;
+					for (; i + 2 * lanes <= size; i += 2 * lanes)
+					{
+						if constexpr (std::is_same_v<T, float>)
+						{
+							auto _x = _mm_loadu_ps(data + i);
+							neumaierSse2(_s0, _c0, _mm_cvtps_pd(_x));
+							neumaierSse2(_s1, _c1, _mm_cvtps_pd(_mm_movehl_ps(_x, _x)));
+						}
+						else
+						{
+							neumaierSse2(_s0, _c0, _mm_loadu_pd(data + i));
+							neumaierSse2(_s1, _c1, _mm_loadu_pd(data + i + lanes));
+						}
+					}
+					_mm_store_pd(_sums, _s0);
+					_mm_store_pd(_sums + lanes, _s1);
+					_mm_store_pd(_compensations, _c0);
+					_mm_store_pd(_compensations + lanes, _c1);
+				}
+
+				return sumCompensatedScalar<T_Sum>(data, size, i, mergeLanes(_sums, _compensations, 2 * lanes));
+			}
+
+			template <typename T_Sum, typename T>
+			LMS_TARGET_AVX2_ T_Sum sumCompensatedAvx2(const T* data, size_t size)
+			{
+				constexpr size_t lanes = 32 / sizeof(T_Sum);
+				alignas(32) T_Sum _sums[2 * lanes];
+				alignas(32) T_Sum _compensations[2 * lanes];
+				size_t i = 0;
+
+				if constexpr (std::is_same_v<T_Sum, float>)
+				{
+					auto _s0 = _mm256_setzero_ps(), _s1 = _s0, _c0 = _s0, _c1 = _s0;
+					for (; i + 2 * lanes <= size; i += 2 * lanes)
+					{
+						neumaierAvx2(_s0, _c0, _mm256_loadu_ps(data + i));
+						neumaierAvx2(_s1, _c1, _mm256_loadu_ps(data + i + lanes));
+					}
+					_mm256_store_ps(_sums, _s0);
+					_mm256_store_ps(_sums + lanes, _s1);
+					_mm256_store_ps(_compensations, _c0);
+					_mm256_store_ps(_compensations + lanes, _c1);
+				}
+				else
+				{
+					auto _s0 = _mm256_setzero_pd(), _s1 = _s0, _c0 = _s0, _c1 = _s0;
+					for (; i + 2 * lanes <= size; i += 2 * lanes)
+					{
+						if constexpr (std::is_same_v<T, float>)
+						{
+							neumaierAvx2(_s0, _c0, _mm256_cvtps_pd(_mm_loadu_ps(data + i)));
+							neumaierAvx2(_s1, _c1, _mm256_cvtps_pd(_mm_loadu_ps(data + i + lanes)));
+						}
+						else
+						{
+							neumaierAvx2(_s0, _c0, _mm256_loadu_pd(data + i));
+							neumaierAvx2(_s1, _c1, _mm256_loadu_pd(data + i + lanes));
+						}
+					}
+					_mm256_store_pd(_sums, _s0);
+					_mm256_store_pd(_sums + lanes, _s1);
+					_mm256_store_pd(_compensations, _c0);
+					_mm256_store_pd(_compensations + lanes, _c1);
+				}
+
+				return sumCompensatedScalar<T_Sum>(data, size, i, mergeLanes(_sums, _compensations, 2 * lanes));
+			}
+
+			// SSE2 has no 64-bit integer compare, so those stay scalar
+			template <typename T>
+			LMS_TARGET_SSE2_ std::pair<T, T> minMaxSse2(const T* data, size_t size)
+			{
+				constexpr size_t lanes = 16 / sizeof(T);
+				alignas(16) T _min[lanes];
+				alignas(16) T _max[lanes];
+				size_t i = lanes;
+
+				if (size < lanes)
+					return minMaxScalar(data, size);
+
+				if constexpr (std::is_same_v<T, float>)
+				{
+					auto _lo = _mm_loadu_ps(data), _hi = _lo;
+					for (; i + lanes <= size; i += lanes)
+					{
+						auto _x = _mm_loadu_ps(data + i);
+						_lo = _mm_min_ps(_lo, _x);
+						_hi = _mm_max_ps(_hi, _x);
+					}
+					_mm_store_ps(_min, _lo);
+					_mm_store_ps(_max, _hi);
+				}
+				else if constexpr (std::is_same_v<T, double>)
+				{
+					auto _lo = _mm_loadu_pd(data), _hi = _lo;
+					for (; i + lanes <= size; i += lanes)
+					{
+						auto _x = _mm_loadu_pd(data + i);
+						_lo = _mm_min_pd(_lo, _x);
+						_hi = _mm_max_pd(_hi, _x);
+					}
+					_mm_store_pd(_min, _lo);
+					_mm_store_pd(_max, _hi);
+				}
+				else if constexpr (sizeof(T) == 4)
+				{
+					auto _lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)), _hi = _lo;
+					for (; i + lanes <= size; i += lanes)
+					{
+						auto _x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+						auto _less = _mm_cmplt_epi32(_x, _lo);
+						auto _greater = _mm_cmpgt_epi32(_x, _hi);
+						_lo = _mm_or_si128(_mm_and_si128(_less, _x), _mm_andnot_si128(_less, _lo));
+						_hi = _mm_or_si128(_mm_and_si128(_greater, _x), _mm_andnot_si128(_greater, _hi));
+					}
+					_mm_store_si128(reinterpret_cast<__m128i*>(_min), _lo);
+					_mm_store_si128(reinterpret_cast<__m128i*>(_max), _hi);
+				}
+				else
+					return minMaxScalar(data, size);
+
+				auto _minMax = minMaxScalar(_min, lanes);
+				_minMax.second = minMaxScalar(_max, lanes).second;
+
+				return minMaxScalar(data, size, i, _minMax);
+			}
+
+			template <typename T>
+			LMS_TARGET_AVX2_ std::pair<T, T> minMaxAvx2(const T* data, size_t size)
+			{
+				constexpr size_t lanes = 32 / sizeof(T);
+				alignas(32) T _min[lanes];
+				alignas(32) T _max[lanes];
+				size_t i = lanes;
+
+				if (size < lanes)
+					return minMaxScalar(data, size);
+
+				if constexpr (std::is_same_v<T, float>)
+				{
+					auto _lo = _mm256_loadu_ps(data), _hi = _lo;
+					for (; i + lanes <= size; i += lanes)
+					{
+						auto _x = _mm256_loadu_ps(data + i);
+						_lo = _mm256_min_ps(_lo, _x);
+						_hi = _mm256_max_ps(_hi, _x);
+					}
+					_mm256_store_ps(_min, _lo);
+					_mm256_store_ps(_max, _hi);
+				}
+				else if constexpr (std::is_same_v<T, double>)
+				{
+					auto _lo = _mm256_loadu_pd(data), _hi = _lo;
+					for (; i + lanes <= size; i += lanes)
+					{
+						auto _x = _mm256_loadu_pd(data + i);
+						_lo = _mm256_min_pd(_lo, _x);
+						_hi = _mm256_max_pd(_hi, _x);
+					}
+					_mm256_store_pd(_min, _lo);
+					_mm256_store_pd(_max, _hi);
+				}
+				else if constexpr (sizeof(T) == 4)
+				{
+					auto _lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data)), _hi = _lo;
+					for (; i + lanes <= size; i += lanes)
+					{
+						auto _x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+						_lo = _mm256_min_epi32(_lo, _x);
+						_hi = _mm256_max_epi32(_hi, _x);
+					}
+					_mm256_store_si256(reinterpret_cast<__m256i*>(_min), _lo);
+					_mm256_store_si256(reinterpret_cast<__m256i*>(_max), _hi);
+				}
+				else
+				{
+					auto _lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data)), _hi = _lo;
+					for (; i + lanes <= size; i += lanes)
+					{
+						auto _x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+						_lo = _mm256_blendv_epi8(_lo, _x, _mm256_cmpgt_epi64(_lo, _x));
+						_hi = _mm256_blendv_epi8(_hi, _x, _mm256_cmpgt_epi64(_x, _hi));
+					}
+					_mm256_store_si256(reinterpret_cast<__m256i*>(_min), _lo);
+					_mm256_store_si256(reinterpret_cast<__m256i*>(_max), _hi);
+				}
+
+				auto _minMax = minMaxScalar(_min, lanes);
+				_minMax.second = minMaxScalar(_max, lanes).second;
+
+				return minMaxScalar(data, size, i, _minMax);
+			}
+#endif
+		}  // namespace detail
+
+		// Floating point sums are accumulated lane by lane, so their rounding
+		// differs slightly from a sequential loop. Integer sums wrap.
+		template <Vectorizable T>
+		T Sum(std::span<const T> elements, Level level = simd::level())
+		{
+#if LMS_X86_
+			if (level == Level::AVX2)
+				return detail::sumAvx2(elements.data(), elements.size());
+			if (level == Level::SSE2)
+				return detail::sumSse2(elements.data(), elements.size());
+#endif
+			return detail::sumScalar(elements.data(), elements.size());
+		}
+
+		// Sum of 'elements' in a possibly wider accumulator. Pairwise sums
+		// hand every block to the Naive kernel.
+		template <typename T_Sum, typename T>
+			requires Accumulable<T_Sum, T>
+		T_Sum Accumulate(std::span<const T> elements, Summation summation = Summation::Naive, Level level = simd::level())
+		{
+			if constexpr (std::floating_point<T_Sum>)
+			{
+				if (summation == Summation::Compensated)
+				{
+#if LMS_X86_
+					if (level == Level::AVX2)
+						return detail::sumCompensatedAvx2<T_Sum>(elements.data(), elements.size());
+					if (level == Level::SSE2)
+						return detail::sumCompensatedSse2<T_Sum>(elements.data(), elements.size());
+#endif
+					return detail::sumCompensatedScalar<T_Sum>(elements.data(), elements.size());
+				}
+				if (summation == Summation::Pairwise)
+				{
+					constexpr auto BLOCK_SIZE = summation::Pairwise<T_Sum>::BLOCK_SIZE;
+					summation::Pairwise<T_Sum> _sum;
+					size_t i = 0;
+
+					for (; i + BLOCK_SIZE <= elements.size(); i += BLOCK_SIZE)
+						_sum.AddBlock(Accumulate<T_Sum>(elements.subspan(i, BLOCK_SIZE), Summation::Naive, level));
+					for (auto x : elements.subspan(i))
+						_sum.Add(static_cast<T_Sum>(x));
+
+					return _sum.Value();
+				}
+			}
+
+			if constexpr (std::is_same_v<T_Sum, T>)
+				return Sum(elements, level);
+			else
+			{
+#if LMS_X86_
+				if (level == Level::AVX2)
+					return detail::sumWideAvx2<T_Sum>(elements.data(), elements.size());
+				if (level == Level::SSE2)
+					return detail::sumWideSse2<T_Sum>(elements.data(), elements.size());
+#endif
+				return detail::sumScalar<T, T_Sum>(elements.data(), elements.size());
+			}
+		}
+
+		// 'elements' must not be empty
+		template <Vectorizable T>
+		std::pair<T, T> MinMax(std::span<const T> elements, Level level = simd::level())
+		{
+#if LMS_X86_
+			if (level == Level::AVX2)
+				return detail::minMaxAvx2(elements.data(), elements.size());
+			if (level == Level::SSE2)
+				return detail::minMaxSse2(elements.data(), elements.size());
+#endif
+			return detail::minMaxScalar(elements.data(), elements.size());
+		}
+	}  // namespace simd
+}  // namespace linq
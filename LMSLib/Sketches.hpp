@@ -0,0 +1,572 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace linq
+{
+	// Streaming summaries behind ApproxCountDistinct(), ApproxQuantile() and
+	// TopKFrequent(). Each takes its elements one at a time in memory that
+	// does not grow with their number, and two summaries of different parts
+	// of a sequence merge into one of the whole, which is how the parallel
+	// versions combine their chunks.
+	namespace detail
+	{
+		// std::hash of integers is the identity, whose high bits carry next
+		// to nothing and which multiplicative hashing does not help for keys
+		// that are multiples of a similar constant; the splitmix64 finalizer
+		// spreads every bit over all others
+		inline uint64_t mix64(uint64_t hash)
+		{
+			hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+			hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+
+			return hash ^ (hash >> 31);
+		}
+	}  // namespace detail
+
+	namespace sketches
+	{
+		// Estimates the number of distinct elements from the longest run of
+		// leading zero bits among their hashes, in 2^precision registers of a
+		// byte each. The relative error is about 1.04 / sqrt(2^precision),
+		// 1.6% for the default precision of 12; small counts are exact or
+		// nearly so. Merging two sketches gives the sketch of their union.
+		template <typename T, typename Hasher = std::hash<T>>
+		class HyperLogLog
+		{
+		public:
+			explicit HyperLogLog(int precision = 12, Hasher hasher = Hasher()) : _precision(precision), _hasher(std::move(hasher))
+			{
+				if (precision < 4 || precision > 18)
+					throw std::out_of_range("HyperLogLog() : 'precision' is not in [4, 18]");
+
+				_registers.assign(size_t(1) << precision, 0);
+			}
+
+			void Add(const T& element)
+			{
+				auto _hash = detail::mix64(uint64_t(_hasher(element)));
+				auto _register = size_t(_hash >> (64 - _precision));
+				// The marker bit bounds the run for hashes of all zeros
+				auto _rank = uint8_t(std::countl_zero((_hash << _precision) | (uint64_t(1) << (_precision - 1))) + 1);
+
+				_registers[_register] = std::max(_registers[_register], _rank);
+			}
+
+			void Merge(const HyperLogLog& other)
+			{
+				if (other._precision != _precision)
+					throw std::invalid_argument("HyperLogLog::Merge() : The sketches have different precisions");
+
+				for (size_t i = 0; i < _registers.size(); i++)
+					_registers[i] = std::max(_registers[i], other._registers[i]);
+			}
+
+			double Estimate(void) const
+			{
+				auto _m = double(_registers.size());
+				auto _sum = 0.0;
+				size_t _zeros = 0;
+
+				for (auto x : _registers)
+				{
+					_sum += std::ldexp(1.0, -x);
+					_zeros += x == 0;
+				}
+
+				auto _estimate = 0.7213 / (1 + 1.079 / _m) * _m * _m / _sum;
+
+				// Counting the empty registers is more accurate for small sets
+				if (_estimate <= 2.5 * _m && _zeros != 0)
+					return _m * std::log(_m / double(_zeros));
+
+				return _estimate;
+			}
+
+			int Precision(void) const { return _precision; }
+
+		private:
+			int _precision;
+			Hasher _hasher;
+			std::vector<uint8_t> _registers;
+
+		};
+
+		// KLL sketch of the distribution of the elements, for quantiles of
+		// any ordered type. Elements are kept in levels; whenever the sketch
+		// is full, the lowest level over its capacity is sorted and every
+		// other element of it, starting at random, moves up a level with
+		// twice the weight. Capacities shrink by 2/3 per level below the
+		// top down to 8, so the sketch holds about 3k elements plus eight
+		// per doubling of the input. The rank of a quantile is off by about 1.7 / k of
+		// the number of elements, 0.85% for the default k of 200.
+		template <typename T, typename Compare = std::less<T>>
+		class QuantileSketch
+		{
+		public:
+			explicit QuantileSketch(int k = 200, Compare compare = Compare()) : _k(k), _compare(std::move(compare))
+			{
+				if (k < 8)
+					throw std::out_of_range("QuantileSketch() : 'k' is less than 8");
+
+				AddLevel();
+			}
+
+			void Add(const T& element)
+			{
+				if (!_min || _compare(element, *_min))
+					_min = element;
+				if (!_max || _compare(*_max, element))
+					_max = element;
+
+				_levels[0].push_back(element);
+				_count++;
+				if (++_size >= _capacity)
+					Compress();
+			}
+
+			void Merge(const QuantileSketch& other)
+			{
+				if (other._count == 0)
+					return;
+				if (!_min || _compare(*other._min, *_min))
+					_min = other._min;
+				if (!_max || _compare(*_max, *other._max))
+					_max = other._max;
+
+				while (_levels.size() < other._levels.size())
+					AddLevel();
+				for (size_t i = 0; i < other._levels.size(); i++)
+					_levels[i].insert(std::end(_levels[i]), std::begin(other._levels[i]), std::end(other._levels[i]));
+
+				_count += other._count;
+				_size += other._size;
+				while (_size >= _capacity)
+					Compress();
+			}
+
+			// Number of elements added, including those of merged sketches
+			size_t Count(void) const { return _count; }
+
+			// The smallest element with at least 'q' of all elements at or
+			// below it. The minimum for 0 and the maximum for 1 are exact.
+			T Quantile(double q) const
+			{
+				if (!(q >= 0 && q <= 1))
+					throw std::out_of_range("QuantileSketch::Quantile() : 'q' is not in [0, 1]");
+				if (_count == 0)
+					throw std::runtime_error("QuantileSketch::Quantile() : The sketch is empty");
+				if (q == 0)
+					return *_min;
+				if (q == 1)
+					return *_max;
+
+				std::vector<std::pair<const T*, uint64_t>> _weighted;
+				uint64_t _total = 0;
+
+				_weighted.reserve(_size);
+				for (size_t i = 0; i < _levels.size(); i++)
+					for (const auto& x : _levels[i])
+					{
+						_weighted.emplace_back(&x, uint64_t(1) << i);
+						_total += uint64_t(1) << i;
+					}
+
+				std::sort(std::begin(_weighted), std::end(_weighted), [&](const auto& x, const auto& y) { return _compare(*x.first, *y.first); });
+
+				auto _rank = q * double(_total);
+				uint64_t _cumulative = 0;
+
+				for (const auto& [x, weight] : _weighted)
+				{
+					_cumulative += weight;
+					if (double(_cumulative) >= _rank)
+						return *x;
+				}
+
+				return *_weighted.back().first;
+			}
+
+		private:
+			int _k;
+			Compare _compare;
+			std::vector<std::vector<T>> _levels;
+			// Capacities of the levels, which change with their number
+			std::vector<size_t> _capacities;
+			std::optional<T> _min, _max;
+			size_t _count = 0;
+			size_t _size = 0;
+			// Sum of the capacities, beyond which the sketch is compressed
+			size_t _capacity = 0;
+			// Decides which half of a compacted level survives
+			uint64_t _random = 0x9E3779B97F4A7C15ull;
+
+			void AddLevel(void)
+			{
+				_levels.emplace_back();
+				_capacities.resize(_levels.size());
+				_capacity = 0;
+
+				for (size_t i = 0; i < _levels.size(); i++)
+				{
+					auto _depth = double(_levels.size() - 1 - i);
+
+					_capacities[i] = std::max<size_t>(8, size_t(std::ceil(_k * std::pow(2.0 / 3, _depth))));
+					_capacity += _capacities[i];
+				}
+			}
+
+			void Compress(void)
+			{
+				for (size_t i = 0; i < _levels.size(); i++)
+				{
+					if (_levels[i].size() < _capacities[i])
+						continue;
+
+					if (i + 1 == _levels.size())
+						AddLevel();
+
+					auto& _level = _levels[i];
+					auto& _above = _levels[i + 1];
+					// An odd element out stays where it is
+					auto _pairs = _level.size() / 2;
+					auto _offset = size_t(NextBit());
+
+					std::sort(std::begin(_level), std::end(_level), _compare);
+					for (size_t j = 0; j < _pairs; j++)
+						_above.push_back(std::move(_level[2 * j + _offset]));
+					if (_level.size() % 2 != 0)
+						_level[0] = std::move(_level.back());
+					_level.resize(_level.size() % 2);
+
+					_size -= _pairs;
+					return;
+				}
+			}
+
+			bool NextBit(void)
+			{
+				_random ^= _random << 13;
+				_random ^= _random >> 7;
+				_random ^= _random << 17;
+
+				return (_random >> 32) & 1;
+			}
+		};
+
+		// Estimated number of occurrences of an element, at most 'error' more
+		// than the true one
+		template <typename T>
+		struct Frequency
+		{
+			T element;
+			size_t count;
+			size_t error;
+		};
+
+		// Space-Saving summary of the most frequent elements in 'capacity'
+		// counters. An element without a counter takes over the one with
+		// the lowest count and inherits it as its error, so counts never
+		// underestimate, no count is off by more than n / capacity, and
+		// every element occurring more often than that has a counter.
+		// Counters of equal count share a bucket in a list of ascending
+		// counts (the Stream-Summary of Metwally et al.), so that counting
+		// moves a counter to the next bucket in constant time, and they are
+		// found through an open-addressing table of fixed size; the summary
+		// does not allocate after its construction.
+		template <typename T, typename Hasher = std::hash<T>, typename Equality = std::equal_to<T>>
+		class HeavyHitters
+		{
+		public:
+			explicit HeavyHitters(int capacity, Hasher hasher = Hasher(), Equality equality = Equality())
+				: _capacity(size_t(capacity)), _hasher(std::move(hasher)), _equality(std::move(equality))
+			{
+				if (capacity < 1)
+					throw std::out_of_range("HeavyHitters() : 'capacity' is less than 1");
+
+				size_t _size = 16;
+
+				for (_shift = 60; _size < 2 * _capacity; _shift--)
+					_size *= 2;
+				_table.assign(_size, 0);
+				_mask = _size - 1;
+				_entries.reserve(_capacity);
+				_buckets.reserve(_capacity);
+				_freeBuckets.reserve(_capacity);
+			}
+
+			void Add(const T& element)
+			{
+				_count++;
+
+				auto i = Find(element);
+
+				if (_table[i] != 0)
+					Increment(_table[i] - 1);
+				else if (_entries.size() < _capacity)
+				{
+					_entries.push_back({ { element, 0, 0 }, NONE, NONE, NONE });
+					_table[i] = uint32_t(_entries.size());
+					Increment(_entries.size() - 1);
+				}
+				else
+				{
+					auto _entry = _buckets[_min].first;
+					auto& _frequency = _entries[_entry].frequency;
+
+					Erase(Find(_frequency.element));
+					_table[Find(element)] = uint32_t(_entry + 1);
+					_frequency.element = element;
+					_frequency.error = _frequency.count;
+					Increment(_entry);
+				}
+			}
+
+			// Merges the counters of both summaries, elements missing from a
+			// full one counting as its lowest count, and keeps the largest
+			void Merge(const HeavyHitters& other)
+			{
+				auto _floor = Floor();
+				auto _otherFloor = other.Floor();
+				std::vector<Frequency<T>> _frequencies;
+
+				_frequencies.reserve(_entries.size() + other._entries.size());
+				for (const auto& x : _entries)
+				{
+					auto i = other.Find(x.frequency.element);
+					auto _other = other._table[i] == 0 ? Frequency<T>{ x.frequency.element, _otherFloor, _otherFloor }
+						: other._entries[other._table[i] - 1].frequency;
+
+					_frequencies.push_back({ x.frequency.element, x.frequency.count + _other.count, x.frequency.error + _other.error });
+				}
+				for (const auto& x : other._entries)
+					if (_table[Find(x.frequency.element)] == 0)
+						_frequencies.push_back({ x.frequency.element, x.frequency.count + _floor, x.frequency.error + _floor });
+
+				SortByCount(_frequencies);
+				if (_frequencies.size() > _capacity)
+					_frequencies.resize(_capacity);
+
+				_count += other._count;
+				std::fill(std::begin(_table), std::end(_table), 0);
+				_entries.clear();
+				_buckets.clear();
+				_freeBuckets.clear();
+				_min = NONE;
+
+				// From the lowest count up, each bucket goes after the highest
+				for (auto it = std::rbegin(_frequencies); it != std::rend(_frequencies); ++it)
+				{
+					auto _highest = _min == NONE ? NONE : _buckets[_min].previous;
+
+					_table[Find(it->element)] = uint32_t(_entries.size() + 1);
+					_entries.push_back({ std::move(*it), NONE, NONE, NONE });
+					if (_highest == NONE || _buckets[_highest].count != _entries.back().frequency.count)
+						_highest = NewBucket(_entries.back().frequency.count, _highest);
+					Link(_entries.size() - 1, _highest);
+				}
+			}
+
+			// Number of elements added, including those of merged summaries
+			size_t Count(void) const { return _count; }
+
+			// The 'k' elements with the highest counts, highest first
+			std::vector<Frequency<T>> Top(int k) const
+			{
+				std::vector<Frequency<T>> _frequencies;
+
+				_frequencies.reserve(_entries.size());
+				for (const auto& x : _entries)
+					_frequencies.push_back(x.frequency);
+				SortByCount(_frequencies);
+				if (_frequencies.size() > size_t(std::max(k, 0)))
+					_frequencies.resize(size_t(std::max(k, 0)));
+
+				return _frequencies;
+			}
+
+		private:
+			static constexpr size_t NONE = static_cast<size_t>(-1);
+
+			// A counter and its neighbours in its bucket
+			struct Entry
+			{
+				Frequency<T> frequency;
+				size_t bucket;
+				size_t previous;
+				size_t next;
+			};
+
+			// Counters with the same count, between the buckets with the next
+			// lower and higher counts. The list is circular, so the bucket
+			// before the lowest one is the highest one.
+			struct Bucket
+			{
+				size_t count;
+				size_t first;
+				size_t previous;
+				size_t next;
+			};
+
+			size_t _capacity;
+			size_t _count = 0;
+			Hasher _hasher;
+			Equality _equality;
+			std::vector<Entry> _entries;
+			std::vector<Bucket> _buckets;
+			std::vector<size_t> _freeBuckets;
+			// The bucket with the lowest count
+			size_t _min = NONE;
+			// Linearly probed 'index + 1' of the entry of an element, 0 when
+			// empty, at most half full
+			std::vector<uint32_t> _table;
+			size_t _mask;
+			int _shift;
+
+			// What an element without a counter may have occurred
+			size_t Floor(void) const { return _entries.size() < _capacity ? 0 : _buckets[_min].count; }
+
+			// Moves 'entry' into the bucket for its count plus one, which is
+			// the next one up from its current bucket if there is any
+			void Increment(size_t entry)
+			{
+				auto _old = _entries[entry].bucket;
+				auto _count = ++_entries[entry].frequency.count;
+				auto _next = _old == NONE ? _min : _buckets[_old].next == _min ? NONE : _buckets[_old].next;
+				auto _bucket = _next != NONE && _buckets[_next].count == _count ? _next : NewBucket(_count, _old);
+
+				if (_old != NONE)
+				{
+					Unlink(entry);
+					if (_buckets[_old].first == NONE)
+						FreeBucket(_old);
+				}
+				Link(entry, _bucket);
+			}
+
+			// A bucket of 'count' right after bucket 'after', or the lowest
+			// one for NONE
+			size_t NewBucket(size_t count, size_t after)
+			{
+				size_t _bucket;
+
+				if (_freeBuckets.empty())
+				{
+					_bucket = _buckets.size();
+					_buckets.push_back({});
+				}
+				else
+				{
+					_bucket = _freeBuckets.back();
+					_freeBuckets.pop_back();
+				}
+
+				if (_min == NONE)
+				{
+					_buckets[_bucket] = { count, NONE, _bucket, _bucket };
+					_min = _bucket;
+					return _bucket;
+				}
+
+				auto _previous = after == NONE ? _buckets[_min].previous : after;
+				auto _next = _buckets[_previous].next;
+
+				_buckets[_bucket] = { count, NONE, _previous, _next };
+				_buckets[_previous].next = _bucket;
+				_buckets[_next].previous = _bucket;
+				if (after == NONE)
+					_min = _bucket;
+
+				return _bucket;
+			}
+
+			void FreeBucket(size_t bucket)
+			{
+				auto [_count, _first, _previous, _next] = _buckets[bucket];
+
+				if (_next == bucket)
+					_min = NONE;
+				else
+				{
+					_buckets[_previous].next = _next;
+					_buckets[_next].previous = _previous;
+					if (_min == bucket)
+						_min = _next;
+				}
+
+				_freeBuckets.push_back(bucket);
+			}
+
+			void Link(size_t entry, size_t bucket)
+			{
+				auto& _entry = _entries[entry];
+
+				_entry.bucket = bucket;
+				_entry.previous = NONE;
+				_entry.next = _buckets[bucket].first;
+				if (_entry.next != NONE)
+					_entries[_entry.next].previous = entry;
+				_buckets[bucket].first = entry;
+			}
+
+			void Unlink(size_t entry)
+			{
+				auto& _entry = _entries[entry];
+
+				if (_entry.previous != NONE)
+					_entries[_entry.previous].next = _entry.next;
+				else
+					_buckets[_entry.bucket].first = _entry.next;
+				if (_entry.next != NONE)
+					_entries[_entry.next].previous = _entry.previous;
+			}
+
+			size_t Home(const T& element) const { return size_t(detail::mix64(uint64_t(_hasher(element))) >> _shift); }
+
+			// The position of 'element' in the table, or the empty one it
+			// would take
+			size_t Find(const T& element) const
+			{
+				auto i = Home(element);
+
+				while (_table[i] != 0 && !_equality(_entries[_table[i] - 1].frequency.element, element))
+					i = (i + 1) & _mask;
+
+				return i;
+			}
+
+			// Empties position 'i' and moves later elements of the probe
+			// sequence back into the gap, so no lookup stops short of them
+			void Erase(size_t i)
+			{
+				_table[i] = 0;
+
+				for (auto j = (i + 1) & _mask; _table[j] != 0; j = (j + 1) & _mask)
+				{
+					auto _home = Home(_entries[_table[j] - 1].frequency.element);
+
+					if (((j - _home) & _mask) >= ((j - i) & _mask))
+					{
+						_table[i] = _table[j];
+						_table[j] = 0;
+						i = j;
+					}
+				}
+			}
+
+			// Ties keep their order, so exact summaries list ties as added
+			static void SortByCount(std::vector<Frequency<T>>& frequencies)
+			{
+				std::stable_sort(std::begin(frequencies), std::end(frequencies), [](const auto& x, const auto& y) { return x.count > y.count; });
+			}
+		};
+	}  // namespace sketches
+}  // namespace linq
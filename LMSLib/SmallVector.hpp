@@ -0,0 +1,242 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace linq
+{
+	// Number of elements an Enumerable<T> and the results of its operators
+	// hold inline before they allocate, 16 for elements of up to 16 bytes
+	// and at most 256 bytes' worth otherwise. Specialize it to tune a type;
+	// 0 makes every sequence of that type allocate.
+	template <typename T>
+	struct InlineCapacity : std::integral_constant<size_t, std::min<size_t>(16, 256 / sizeof(T))> {};
+
+	namespace detail
+	{
+		// Vector that keeps up to N elements in place and moves them into a
+		// std::vector once it outgrows them, from which point on it grows
+		// like that vector. Adopting a std::vector takes over its buffer
+		// without copying. Only the std::vector interface that Enumerable
+		// needs is provided; inline elements are constructed directly, not
+		// through the allocator.
+		template <typename T, size_t N, typename Allocator = std::allocator<T>>
+		class SmallVector
+		{
+		public:
+			using value_type = T;
+			using allocator_type = Allocator;
+			using iterator = T*;
+			using const_iterator = const T*;
+
+			explicit SmallVector(const Allocator& allocator = Allocator()) : _heap(allocator) {}
+			template <std::forward_iterator Iterator>
+			SmallVector(Iterator first, Iterator last, const Allocator& allocator = Allocator()) : _heap(allocator)
+			{
+				insert(end(), first, last);
+			}
+			SmallVector(const std::vector<T, Allocator>& vector) : SmallVector(std::begin(vector), std::end(vector), vector.get_allocator()) {}
+			SmallVector(std::vector<T, Allocator>&& vector) : _heap(std::move(vector)), _spilled(true) {}
+
+			SmallVector(const SmallVector& other)
+				: _heap(std::allocator_traits<Allocator>::select_on_container_copy_construction(other.get_allocator()))
+			{
+				insert(end(), other.begin(), other.end());
+			}
+			SmallVector(SmallVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>)
+				: _heap(std::move(other._heap)), _spilled(other._spilled)
+			{
+				if (!_spilled)
+					TakeInline(other);
+			}
+
+			~SmallVector(void) { clear(); }
+
+			SmallVector& operator=(const SmallVector& other)
+			{
+				if (this != &other)
+				{
+					clear();
+					insert(end(), other.begin(), other.end());
+				}
+
+				return *this;
+			}
+			// Unless the allocator moves along or all of them are equal, e.g. not
+			// for std::pmr, the heap elements move into this vector's memory,
+			// which may throw
+			SmallVector& operator=(SmallVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>
+				&& (std::allocator_traits<Allocator>::propagate_on_container_move_assignment::value
+					|| std::allocator_traits<Allocator>::is_always_equal::value))
+			{
+				if (this != &other)
+				{
+					clear();
+					_heap = std::move(other._heap);
+					_spilled = other._spilled;
+					if (!_spilled)
+						TakeInline(other);
+				}
+
+				return *this;
+			}
+
+			T* data(void) { return _spilled ? _heap.data() : Inline(); }
+			const T* data(void) const { return _spilled ? _heap.data() : Inline(); }
+			size_t size(void) const { return _spilled ? _heap.size() : _size; }
+			bool empty(void) const { return size() == 0; }
+			Allocator get_allocator(void) const { return _heap.get_allocator(); }
+
+			T* begin(void) { return data(); }
+			T* end(void) { return data() + size(); }
+			const T* begin(void) const { return data(); }
+			const T* end(void) const { return data() + size(); }
+
+			T& operator[](size_t index) { return data()[index]; }
+			const T& operator[](size_t index) const { return data()[index]; }
+
+			void reserve(size_t capacity)
+			{
+				if (_spilled)
+					_heap.reserve(capacity);
+				else if (capacity > N)
+					Spill(capacity);
+			}
+
+			void clear(void)
+			{
+				if (_spilled)
+					_heap.clear();
+				else
+				{
+					std::destroy_n(Inline(), _size);
+					_size = 0;
+				}
+			}
+
+			template <typename... Args>
+			T& emplace_back(Args&&... args)
+			{
+				if (!_spilled && _size < N)
+					return *std::construct_at(Inline() + _size++, std::forward<Args>(args)...);
+
+				if (!_spilled)
+				{
+					// The arguments may refer to an inline element
+					T _element(std::forward<Args>(args)...);
+
+					Spill(2 * N);
+					return _heap.emplace_back(std::move(_element));
+				}
+
+				return _heap.emplace_back(std::forward<Args>(args)...);
+			}
+
+			void push_back(const T& element) { emplace_back(element); }
+			void push_back(T&& element) { emplace_back(std::move(element)); }
+
+			T* insert(const T* position, T element)
+			{
+				auto _offset = size_t(position - data());
+
+				emplace_back(std::move(element));
+				std::rotate(begin() + _offset, end() - 1, end());
+
+				return begin() + _offset;
+			}
+
+			template <std::forward_iterator Iterator>
+			T* insert(const T* position, Iterator first, Iterator last)
+			{
+				auto _offset = size_t(position - data());
+				auto _count = size_t(std::distance(first, last));
+
+				if (!_spilled && _size + _count > N)
+					Spill(std::max(2 * N, _size + _count));
+
+				if (_spilled)
+				{
+					_heap.insert(_heap.begin() + _offset, first, last);
+				}
+				else
+				{
+					auto _oldSize = _size;
+
+					for (; first != last; ++first)
+						std::construct_at(Inline() + _size++, *first);
+					std::rotate(begin() + _offset, begin() + _oldSize, end());
+				}
+
+				return begin() + _offset;
+			}
+
+			T* erase(const T* first, const T* last)
+			{
+				auto _offset = size_t(first - data());
+
+				if (_spilled)
+					_heap.erase(_heap.begin() + _offset, _heap.begin() + (last - data()));
+				else
+				{
+					auto _newEnd = std::move(begin() + (last - data()), end(), begin() + _offset);
+
+					std::destroy(_newEnd, end());
+					_size = size_t(_newEnd - begin());
+				}
+
+				return begin() + _offset;
+			}
+
+			// Hands the elements over as a std::vector, which is free once
+			// they have left the inline buffer
+			std::vector<T, Allocator> Detach(void) &&
+			{
+				if (_spilled)
+					return std::move(_heap);
+
+				std::vector<T, Allocator> _vector(get_allocator());
+
+				_vector.reserve(_size);
+				for (auto& x : *this)
+					_vector.push_back(std::move(x));
+				clear();
+
+				return _vector;
+			}
+
+		private:
+			std::vector<T, Allocator> _heap;
+			alignas(T) std::byte _inline[N == 0 ? 1 : N * sizeof(T)];
+			size_t _size = 0;
+			// Whether the elements live in _heap rather than _inline
+			bool _spilled = N == 0;
+
+			T* Inline(void) { return std::launder(reinterpret_cast<T*>(_inline)); }
+			const T* Inline(void) const { return std::launder(reinterpret_cast<const T*>(_inline)); }
+
+			void Spill(size_t capacity)
+			{
+				_heap.reserve(capacity);
+				for (auto& x : *this)
+					_heap.push_back(std::move(x));
+
+				std::destroy_n(Inline(), _size);
+				_size = 0;
+				_spilled = true;
+			}
+
+			void TakeInline(SmallVector& other)
+			{
+				std::uninitialized_move_n(other.Inline(), other._size, Inline());
+				_size = other._size;
+				other.clear();
+			}
+		};
+	}  // namespace detail
+}  // namespace linq
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Query.hpp"
+
+namespace linq
+{
+	// Sources that generate or read their elements one at a time while a
+	// Query runs, instead of holding them in memory. Generated sources never
+	// allocate; file sources open their file on every run and keep a single
+	// buffer of fixed size, so a query over a file of any size runs in
+	// constant memory.
+	namespace stages
+	{
+		class RangeSource
+		{
+		public:
+			using value_type = int;
+
+			RangeSource(int start, int count) : _start(start), _count(count)
+			{
+				if (count < 0)
+					throw std::out_of_range("linq::Range() : 'count' is less than 0");
+				if (static_cast<long long>(start) + count - 1 > INT_MAX)
+					throw std::out_of_range("linq::Range() : Range exeeds 'INT_MAX'");
+			}
+
+			std::string Explain(void) const { return "Range(" + std::to_string(_start) + ", " + std::to_string(_count) + ")"; }
+
+			template <typename Sink>
+			bool Run(Sink&& sink) const
+			{
+				for (int i = 0; i < _count; i++)
+					if (!sink(_start + i))
+						return false;
+
+				return true;
+			}
+
+		private:
+			int _start;
+			int _count;
+		};
+
+		template <typename T>
+		class RepeatSource
+		{
+		public:
+			using value_type = T;
+
+			RepeatSource(T element, int count) : _element(std::move(element)), _count(count)
+			{
+				if (count < 0)
+					throw std::out_of_range("linq::Repeat() : 'count' is less than 0");
+			}
+
+			std::string Explain(void) const { return "Repeat(" + std::to_string(_count) + ")"; }
+
+			template <typename Sink>
+			bool Run(Sink&& sink) const
+			{
+				for (int i = 0; i < _count; i++)
+					if (!sink(_element))
+						return false;
+
+				return true;
+			}
+
+		private:
+			T _element;
+			int _count;
+		};
+
+		// Every run starts from a fresh copy of the generator, so stateful
+		// generators produce the same sequence each time
+		template <typename Function>
+		class GenerateSource
+		{
+		public:
+			using value_type = std::remove_cvref_t<std::invoke_result_t<Function&>>;
+
+			explicit GenerateSource(Function generator) : _generator(std::move(generator)) {}
+
+			std::string Explain(void) const { return "Generate"; }
+
+			template <typename Sink>
+			bool Run(Sink&& sink) const
+			{
+				auto _next = _generator;
+
+				while (true)
+					if (!sink(_next()))
+						return false;
+			}
+
+		private:
+			Function _generator;
+		};
+
+		// Reads a text file in chunks and splits it into lines without their
+		// line break, '\n' or "\r\n". The same string is reused for every
+		// line, so stages have to copy it to keep it.
+		class LineSource
+		{
+		public:
+			using value_type = std::string;
+
+			LineSource(std::string path, size_t chunkSize) : _path(std::move(path)), _chunkSize(chunkSize == 0 ? 1 : chunkSize) {}
+
+			std::string Explain(void) const { return "ReadLines(" + _path + ")"; }
+
+			template <typename Sink>
+			bool Run(Sink&& sink) const
+			{
+				std::ifstream _file(_path, std::ios::binary);
+
+				if (!_file)
+					throw std::runtime_error("linq::ReadLines() : Could not open '" + _path + "'");
+
+				std::vector<char> _buffer(_chunkSize);
+				std::string _line;
+
+				while (_file)
+				{
+					_file.read(_buffer.data(), std::streamsize(_buffer.size()));
+
+					const char* _begin = _buffer.data();
+					const char* _end = _begin + _file.gcount();
+
+					while (auto _newline = static_cast<const char*>(std::memchr(_begin, '\n', size_t(_end - _begin))))
+					{
+						_line.append(_begin, _newline);
+						if (!Emit(_line, sink))
+							return false;
+						_begin = _newline + 1;
+					}
+
+					_line.append(_begin, _end);
+				}
+
+				return _line.empty() || Emit(_line, sink);
+			}
+
+		private:
+			std::string _path;
+			size_t _chunkSize;
+
+			template <typename Sink>
+			static bool Emit(std::string& line, Sink& sink)
+			{
+				if (!line.empty() && line.back() == '\r')
+					line.pop_back();
+
+				auto _continue = sink(line);
+
+				line.clear();
+
+				return _continue;
+			}
+		};
+
+		// Reads a binary file of back-to-back T records, 'chunkRecords' at a
+		// time. A trailing partial record is an error.
+		template <typename T>
+		class RecordSource
+		{
+		public:
+			using value_type = T;
+
+			RecordSource(std::string path, size_t chunkRecords) : _path(std::move(path)), _chunkRecords(chunkRecords == 0 ? 1 : chunkRecords) {}
+
+			std::string Explain(void) const { return "ReadRecords(" + _path + ")"; }
+
+			template <typename Sink>
+			bool Run(Sink&& sink) const
+			{
+				std::ifstream _file(_path, std::ios::binary);
+
+				if (!_file)
+					throw std::runtime_error("linq::ReadRecords() : Could not open '" + _path + "'");
+
+				std::vector<T> _buffer(_chunkRecords);
+
+				while (_file)
+				{
+					_file.read(reinterpret_cast<char*>(_buffer.data()), std::streamsize(_buffer.size() * sizeof(T)));
+
+					auto _read = size_t(_file.gcount());
+
+					if (_read % sizeof(T) != 0)
+						throw std::runtime_error("linq::ReadRecords() : '" + _path + "' ends in a partial record");
+
+					for (size_t i = 0; i < _read / sizeof(T); i++)
+						if (!sink(_buffer[i]))
+							return false;
+				}
+
+				return true;
+			}
+
+		private:
+			std::string _path;
+			size_t _chunkRecords;
+		};
+	}  // namespace stages
+
+	// The integers [start, start + count)
+	inline auto Range(int start, int count) { return Query<stages::RangeSource>(stages::RangeSource(start, count)); }
+
+	template <typename T>
+	auto Repeat(T element, int count) { return Query<stages::RepeatSource<T>>(stages::RepeatSource<T>(std::move(element), count)); }
+
+	// The endless sequence of generator() results, to be cut short by Take()
+	// or TakeWhile() or by a terminal operation that stops early
+	template <std::invocable Function>
+	auto Generate(Function generator) { return Query<stages::GenerateSource<Function>>(stages::GenerateSource<Function>(std::move(generator))); }
+
+	inline auto ReadLines(std::string path, size_t chunkSize = 1 << 16)
+	{
+		return Query<stages::LineSource>(stages::LineSource(std::move(path), chunkSize));
+	}
+
+	template <typename T>
+	auto ReadRecords(std::string path, size_t chunkRecords = 4096) requires std::is_trivially_copyable_v<T>
+	{
+		return Query<stages::RecordSource<T>>(stages::RecordSource<T>(std::move(path), chunkRecords));
+	}
+}  // namespace linq
@@ -0,0 +1,465 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace linq
+{
+	template <typename T, size_t S, typename Allocator>
+	class Enumerable;
+
+	// Read-only memory mapping of a whole file
+	class MappedFile
+	{
+	public:
+		explicit MappedFile(const std::string& path)
+		{
+#if defined(_WIN32)
+			_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (_file == INVALID_HANDLE_VALUE)
+				throw std::runtime_error("MappedFile::MappedFile() : Could not open '" + path + "'");
+
+			LARGE_INTEGER _size;
+			if (!GetFileSizeEx(_file, &_size))
+			{
+				Close();
+				throw std::runtime_error("MappedFile::MappedFile() : Could not read the size of '" + path + "'");
+			}
+			_length = size_t(_size.QuadPart);
+
+			if (_length != 0)
+			{
+				_mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				if (_mapping != nullptr)
+					_data = static_cast<const std::byte*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+				if (_data == nullptr)
+				{
+					Close();
+					throw std::runtime_error("MappedFile::MappedFile() : Could not map '" + path + "'");
+				}
+			}
+#else
+			_file = open(path.c_str(), O_RDONLY);
+			if (_file < 0)
+				throw std::runtime_error("MappedFile::MappedFile() : Could not open '" + path + "'");
+
+			struct stat _stat;
+			if (fstat(_file, &_stat) != 0)
+			{
+				Close();
+				throw std::runtime_error("MappedFile::MappedFile() : Could not read the size of '" + path + "'");
+			}
+			_length = size_t(_stat.st_size);
+
+			if (_length != 0)
+			{
+				auto _address = mmap(nullptr, _length, PROT_READ, MAP_PRIVATE, _file, 0);
+				if (_address == MAP_FAILED)
+				{
+					Close();
+					throw std::runtime_error("MappedFile::MappedFile() : Could not map '" + path + "'");
+				}
+				_data = static_cast<const std::byte*>(_address);
+			}
+#endif
+		}
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+		MappedFile& operator=(MappedFile&& other) noexcept
+		{
+			if (this != &other)
+			{
+				Close();
+				std::swap(_file, other._file);
+#if defined(_WIN32)
+				std::swap(_mapping, other._mapping);
+#endif
+				std::swap(_data, other._data);
+				std::swap(_length, other._length);
+			}
+			return *this;
+		}
+
+		~MappedFile(void) { Close(); }
+
+		std::span<const std::byte> Bytes(void) const { return { _data, _length }; }
+
+	private:
+#if defined(_WIN32)
+		HANDLE _file = INVALID_HANDLE_VALUE;
+		HANDLE _mapping = nullptr;
+#else
+		int _file = -1;
+#endif
+		const std::byte* _data = nullptr;
+		size_t _length = 0;
+
+		void Close(void)
+		{
+#if defined(_WIN32)
+			if (_data != nullptr)
+				UnmapViewOfFile(_data);
+			if (_mapping != nullptr)
+				CloseHandle(_mapping);
+			if (_file != INVALID_HANDLE_VALUE)
+				CloseHandle(_file);
+			_mapping = nullptr;
+			_file = INVALID_HANDLE_VALUE;
+#else
+			if (_data != nullptr)
+				munmap(const_cast<std::byte*>(_data), _length);
+			if (_file >= 0)
+				close(_file);
+			_file = -1;
+#endif
+			_data = nullptr;
+			_length = 0;
+		}
+	};
+
+	namespace detail
+	{
+		// Layout of a table file, all offsets in bytes from its start:
+		//   TableHeader
+		//   TableColumn[columns]
+		//   records, count * recordSize bytes at 'dataOffset'
+		//   statistics at 'statsOffset', for every block of 'blockRecords'
+		//   records and every column its minimum and then its maximum,
+		//   each stored in the column's own type in an 8-byte slot
+		// Records are stored exactly as in memory, so the loader can hand
+		// them out without copying; the byte order mark rejects files that
+		// were written on a machine of the other endianness.
+		constexpr char TABLE_MAGIC[8] = { 'L', 'M', 'S', 'T', 'A', 'B', 'L', 'E' };
+		constexpr uint32_t TABLE_VERSION = 1;
+		constexpr uint32_t TABLE_BYTE_ORDER = 0x01020304;
+		constexpr uint64_t TABLE_ALIGNMENT = 64;
+		constexpr uint64_t TABLE_BLOCK_RECORDS = 1 << 12;
+
+		struct TableHeader
+		{
+			char magic[8];
+			uint32_t version;
+			uint32_t byteOrder;
+			uint64_t recordSize;
+			uint64_t count;
+			uint64_t blockRecords;
+			uint64_t columns;
+			uint64_t dataOffset;
+			uint64_t statsOffset;
+		};
+
+		enum class ColumnType : uint32_t
+		{
+			Int8, Int16, Int32, Int64, UInt8, UInt16, UInt32, UInt64, Float, Double
+		};
+
+		struct TableColumn
+		{
+			uint32_t offset;
+			ColumnType type;
+		};
+
+		template <typename T>
+		concept ColumnValue = std::is_arithmetic_v<T> && !std::is_same_v<T, bool> && sizeof(T) <= 8;
+
+		template <typename Member>
+		struct MemberTraits;
+
+		template <typename T, typename F>
+		struct MemberTraits<F T::*>
+		{
+			using Class = T;
+			using Field = F;
+		};
+
+		// A pointer to an arithmetic data member of T
+		template <typename Member, typename T>
+		concept ColumnOf = std::is_member_object_pointer_v<Member>
+			&& std::is_same_v<typename MemberTraits<Member>::Class, T>
+			&& ColumnValue<typename MemberTraits<Member>::Field>;
+
+		template <ColumnValue F>
+		constexpr ColumnType columnType(void)
+		{
+			if constexpr (std::is_floating_point_v<F>)
+				return sizeof(F) == 4 ? ColumnType::Float : ColumnType::Double;
+			else if constexpr (std::is_signed_v<F>)
+				return sizeof(F) == 1 ? ColumnType::Int8 : sizeof(F) == 2 ? ColumnType::Int16 : sizeof(F) == 4 ? ColumnType::Int32 : ColumnType::Int64;
+			else
+				return sizeof(F) == 1 ? ColumnType::UInt8 : sizeof(F) == 2 ? ColumnType::UInt16 : sizeof(F) == 4 ? ColumnType::UInt32 : ColumnType::UInt64;
+		}
+
+		// Byte offset of a member, measured on a value-initialized record
+		template <typename T, typename F>
+		uint32_t columnOffset(F T::* member)
+		{
+			T _record{};
+
+			return uint32_t(reinterpret_cast<const char*>(&(_record.*member)) - reinterpret_cast<const char*>(&_record));
+		}
+
+		constexpr uint64_t alignUp(uint64_t offset) { return (offset + TABLE_ALIGNMENT - 1) / TABLE_ALIGNMENT * TABLE_ALIGNMENT; }
+
+		template <typename F>
+		F readSlot(const std::byte* slot)
+		{
+			F _value;
+			std::memcpy(&_value, slot, sizeof(F));
+			return _value;
+		}
+
+		// A column given to ToFile() and the function that computes its
+		// statistics over one block
+		template <typename T>
+		struct ColumnWriter
+		{
+			TableColumn column;
+			void (*minMax)(std::span<const T> block, uint32_t offset, std::byte* slots);
+		};
+
+		template <typename T, ColumnValue F>
+		void blockMinMax(std::span<const T> block, uint32_t offset, std::byte* slots)
+		{
+			auto _field = [&](const T& x) { return readSlot<F>(reinterpret_cast<const std::byte*>(&x) + offset); };
+			auto _min = _field(block[0]), _max = _min;
+
+			for (const auto& x : block)
+			{
+				auto _value = _field(x);
+				_min = std::min(_min, _value);
+				_max = std::max(_max, _value);
+			}
+
+			std::memcpy(slots, &_min, sizeof(F));
+			std::memcpy(slots + 8, &_max, sizeof(F));
+		}
+
+		template <typename T>
+		void writeTable(const std::string& path, std::span<const T> records, uint64_t blockRecords, const std::vector<ColumnWriter<T>>& columns)
+		{
+			std::ofstream _file(path, std::ios::binary | std::ios::trunc);
+
+			if (!_file)
+				throw std::runtime_error("Enumerable<T>::ToFile() : Could not open '" + path + "'");
+
+			auto _blocks = (records.size() + blockRecords - 1) / blockRecords;
+
+			TableHeader _header{};
+			std::memcpy(_header.magic, TABLE_MAGIC, sizeof(TABLE_MAGIC));
+			_header.version = TABLE_VERSION;
+			_header.byteOrder = TABLE_BYTE_ORDER;
+			_header.recordSize = sizeof(T);
+			_header.count = records.size();
+			_header.blockRecords = blockRecords;
+			_header.columns = columns.size();
+			_header.dataOffset = alignUp(sizeof(TableHeader) + columns.size() * sizeof(TableColumn));
+			_header.statsOffset = alignUp(_header.dataOffset + records.size() * sizeof(T));
+
+			std::vector<std::byte> _stats(_blocks * columns.size() * 16);
+
+			for (size_t b = 0; b < _blocks; b++)
+			{
+				auto _block = records.subspan(b * blockRecords, std::min<size_t>(blockRecords, records.size() - b * blockRecords));
+
+				for (size_t c = 0; c < columns.size(); c++)
+					columns[c].minMax(_block, columns[c].column.offset, _stats.data() + (b * columns.size() + c) * 16);
+			}
+
+			auto _pad = [&](uint64_t offset)
+			{
+				static constexpr char _zeros[TABLE_ALIGNMENT] = {};
+				_file.write(_zeros, std::streamsize(offset - uint64_t(_file.tellp())));
+			};
+
+			_file.write(reinterpret_cast<const char*>(&_header), sizeof(_header));
+			for (const auto& column : columns)
+				_file.write(reinterpret_cast<const char*>(&column.column), sizeof(TableColumn));
+			_pad(_header.dataOffset);
+			_file.write(reinterpret_cast<const char*>(records.data()), std::streamsize(records.size_bytes()));
+			_pad(_header.statsOffset);
+			_file.write(reinterpret_cast<const char*>(_stats.data()), std::streamsize(_stats.size()));
+
+			if (!_file)
+				throw std::runtime_error("Enumerable<T>::ToFile() : Could not write '" + path + "'");
+		}
+	}  // namespace detail
+
+	// A table file written by Enumerable<T>::ToFile(), memory-mapped. The
+	// records are used in place, so loading costs a few page faults rather
+	// than parsing, and AsEnumerable() returns a view that must not outlive
+	// the table. Columns given to ToFile() carry per-block minimum and
+	// maximum values, which WhereBetween() uses to skip whole blocks.
+	template <typename T>
+	class MappedTable
+	{
+	public:
+		static_assert(std::is_trivially_copyable_v<T>, "MappedTable<T> : T has to be trivially copyable");
+		static_assert(alignof(T) <= detail::TABLE_ALIGNMENT, "MappedTable<T> : T is over-aligned");
+
+		explicit MappedTable(const std::string& path) : _file(path)
+		{
+			auto _bytes = _file.Bytes();
+			auto _fail = [&](const char* _reason)
+			{
+				throw std::runtime_error("MappedTable<T>::MappedTable() : '" + path + "' " + _reason);
+			};
+
+			if (_bytes.size() < sizeof(detail::TableHeader))
+				_fail("is too small for a table");
+
+			std::memcpy(&_header, _bytes.data(), sizeof(_header));
+
+			if (std::memcmp(_header.magic, detail::TABLE_MAGIC, sizeof(detail::TABLE_MAGIC)) != 0)
+				_fail("is not a table file");
+			if (_header.version != detail::TABLE_VERSION || _header.byteOrder != detail::TABLE_BYTE_ORDER)
+				_fail("has an unsupported version or byte order");
+			if (_header.recordSize != sizeof(T) || _header.blockRecords == 0)
+				_fail("does not hold records of this type");
+
+			if (_header.count > uint64_t(std::numeric_limits<int>::max()))
+				_fail("holds more records than Count() can return");
+
+			// Whether 'count' items of 'size' bytes fit after 'offset', by
+			// division so that a corrupt header cannot wrap the products.
+			// Tables without columns have stats of size 0.
+			auto _fits = [&](uint64_t offset, uint64_t count, uint64_t size)
+			{
+				return offset <= _bytes.size() && (count == 0 || size == 0 || count <= (_bytes.size() - offset) / size);
+			};
+			auto _blocks = _header.count / _header.blockRecords + (_header.count % _header.blockRecords != 0);
+
+			if (_header.dataOffset % detail::TABLE_ALIGNMENT != 0
+				|| !_fits(_header.dataOffset, _header.count, sizeof(T))
+				|| !_fits(sizeof(detail::TableHeader), _header.columns, sizeof(detail::TableColumn))
+				|| sizeof(detail::TableHeader) + _header.columns * sizeof(detail::TableColumn) > _header.dataOffset
+				|| !_fits(_header.statsOffset, _blocks, _header.columns * 16))
+				_fail("is truncated");
+
+			_columns.resize(_header.columns);
+			if (!_columns.empty())
+				std::memcpy(_columns.data(), _bytes.data() + sizeof(detail::TableHeader), _columns.size() * sizeof(detail::TableColumn));
+		}
+
+		auto AsEnumerable(void) const { return Enumerable<T, 0, std::allocator<T>>::View(Records()); }
+
+		int Count(void) const { return int(_header.count); }
+
+		size_t BlockCount(void) const { return _header.count / _header.blockRecords + (_header.count % _header.blockRecords != 0); }
+
+		// Indices of the blocks that may hold a record whose 'member' is in
+		// [low, high], every other block certainly holds none
+		template <detail::ColumnOf<T> Member, typename F = typename detail::MemberTraits<Member>::Field>
+		std::vector<size_t> CandidateBlocks(Member member, std::type_identity_t<F> low, std::type_identity_t<F> high) const
+		{
+			return Candidates(FindColumn(detail::columnOffset(member), detail::columnType<F>()), low, high);
+		}
+
+		std::vector<size_t> CandidateBlocks(T low, T high) const requires detail::ColumnValue<T>
+		{
+			return Candidates(FindColumn(0, detail::columnType<T>()), low, high);
+		}
+
+		// The records whose 'member' is in [low, high], in file order
+		template <detail::ColumnOf<T> Member, typename F = typename detail::MemberTraits<Member>::Field>
+		auto WhereBetween(Member member, std::type_identity_t<F> low, std::type_identity_t<F> high) const
+		{
+			return Between(CandidateBlocks(member, low, high), [&](const T& x) { return !(x.*member < low) && !(high < x.*member); });
+		}
+
+		auto WhereBetween(T low, T high) const requires detail::ColumnValue<T>
+		{
+			return Between(CandidateBlocks(low, high), [&](const T& x) { return !(x < low) && !(high < x); });
+		}
+
+	private:
+		MappedFile _file;
+		detail::TableHeader _header;
+		std::vector<detail::TableColumn> _columns;
+
+		std::span<const T> Records(void) const
+		{
+			return { reinterpret_cast<const T*>(_file.Bytes().data() + _header.dataOffset), size_t(_header.count) };
+		}
+
+		const std::byte* Stats(void) const { return _file.Bytes().data() + _header.statsOffset; }
+
+		size_t FindColumn(uint32_t offset, detail::ColumnType type) const
+		{
+			for (size_t c = 0; c < _columns.size(); c++)
+				if (_columns[c].offset == offset && _columns[c].type == type)
+					return c;
+
+			return SIZE_MAX;
+		}
+
+		// Without statistics for the column every block is a candidate
+		template <typename F>
+		std::vector<size_t> Candidates(size_t column, F low, F high) const
+		{
+			std::vector<size_t> _blocks;
+
+			for (size_t b = 0; b < BlockCount(); b++)
+			{
+				if (column == SIZE_MAX)
+				{
+					_blocks.push_back(b);
+					continue;
+				}
+
+				auto _slots = Stats() + (b * _columns.size() + column) * 16;
+
+				if (!(detail::readSlot<F>(_slots + 8) < low) && !(high < detail::readSlot<F>(_slots)))
+					_blocks.push_back(b);
+			}
+
+			return _blocks;
+		}
+
+		template <typename Function>
+		auto Between(const std::vector<size_t>& blocks, Function predicate) const
+		{
+			auto _records = Records();
+			std::vector<T> _newVec;
+
+			for (auto b : blocks)
+			{
+				auto _first = b * _header.blockRecords;
+				auto _block = _records.subspan(_first, std::min<size_t>(_header.blockRecords, _records.size() - _first));
+
+				for (const auto& x : _block)
+					if (predicate(x))
+						_newVec.push_back(x);
+			}
+
+			return Enumerable<T, 0, std::allocator<T>>(std::move(_newVec));
+		}
+	};
+}  // namespace linq
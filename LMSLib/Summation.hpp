@@ -0,0 +1,189 @@
+#pragma once
+
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <type_traits>
+
+namespace linq
+{
+	// How Sum() and Average() accumulate into a floating point type.
+	// Integer accumulators are exact short of overflowing and ignore it.
+	enum class Summation
+	{
+		// A running sum per vector lane, off by up to the number of elements
+		// times the rounding error of the largest partial sum
+		Naive,
+		// Neumaier's variant of Kahan summation: a second sum collects what
+		// every addition rounded off, so the error does not grow with the
+		// number of elements
+		Compensated,
+		// Blocks of elements summed naively and then added up as a binary
+		// tree, so the error grows with the logarithm of the number of
+		// elements only, at close to the cost of Naive
+		Pairwise
+	};
+
+	namespace summation
+	{
+		template <typename T>
+		constexpr T abs(T x) { return x < 0 ? -x : x; }
+
+		// Integers wrap instead of overflowing into undefined behaviour
+		template <typename T>
+		constexpr T add(T x, T y)
+		{
+			if constexpr (std::is_integral_v<T> && !std::is_same_v<T, bool>)
+				return static_cast<T>(static_cast<std::make_unsigned_t<T>>(x) + static_cast<std::make_unsigned_t<T>>(y));
+			else
+				return x + y;
+		}
+
+		// The inverse of add(), wrapping the same way
+		template <typename T>
+		constexpr T subtract(T x, T y)
+		{
+			if constexpr (std::is_integral_v<T> && !std::is_same_v<T, bool>)
+				return static_cast<T>(static_cast<std::make_unsigned_t<T>>(x) - static_cast<std::make_unsigned_t<T>>(y));
+			else
+				return x - y;
+		}
+
+		template <std::floating_point T>
+		class Compensated
+		{
+		public:
+			constexpr Compensated(T sum = T(), T compensation = T()) : _sum(sum), _compensation(compensation) {}
+
+			constexpr void Add(T x)
+			{
+				auto _next = _sum + x;
+
+				// Whichever of the two is smaller lost its low bits
+				if (abs(_sum) >= abs(x))
+					_compensation += (_sum - _next) + x;
+				else
+					_compensation += (x - _next) + _sum;
+				_sum = _next;
+			}
+
+			constexpr void Merge(const Compensated& other)
+			{
+				Add(other._sum);
+				_compensation += other._compensation;
+			}
+
+			constexpr T Value(void) const { return _sum + _compensation; }
+
+		private:
+			T _sum;
+			T _compensation;
+		};
+
+		// Streaming pairwise summation: full blocks are merged like the digits
+		// of a binary counter, so that only sums of equally many blocks are
+		// ever added to each other
+		template <std::floating_point T>
+		class Pairwise
+		{
+		public:
+			static constexpr size_t BLOCK_SIZE = 128;
+
+			constexpr void Add(T x)
+			{
+				_block += x;
+				if (++_blockSize == BLOCK_SIZE)
+				{
+					AddBlock(_block);
+					_block = T();
+					_blockSize = 0;
+				}
+			}
+
+			// Adds the sum of BLOCK_SIZE elements at once, e.g. from a
+			// vectorized kernel
+			constexpr void AddBlock(T sum)
+			{
+				size_t _level = 0;
+
+				for (; (_blocks >> _level) & 1; _level++)
+					sum = _partials[_level] + sum;
+				_partials[_level] = sum;
+				_blocks++;
+			}
+
+			constexpr T Value(void) const
+			{
+				auto _sum = _block;
+
+				for (size_t i = 0; i < _partials.size(); i++)
+					if ((_blocks >> i) & 1)
+						_sum += _partials[i];
+
+				return _sum;
+			}
+
+		private:
+			// Sum of 2^i blocks when bit i of _blocks is set
+			std::array<T, 64> _partials{};
+			size_t _blocks = 0;
+			T _block = T();
+			size_t _blockSize = 0;
+		};
+
+		// Calls 'forEach' with a function that adds an element to a sum in
+		// T_Sum, and returns the sum. The mode is only looked at once, not
+		// for every element. Integer sums wrap, like simd::Sum().
+		template <typename T_Sum, typename Function>
+		constexpr T_Sum Accumulate(Summation summation, Function forEach)
+		{
+			if constexpr (std::floating_point<T_Sum>)
+			{
+				if (summation == Summation::Compensated)
+				{
+					Compensated<T_Sum> _sum;
+
+					forEach([&](const auto& x) { _sum.Add(static_cast<T_Sum>(x)); });
+
+					return _sum.Value();
+				}
+				if (summation == Summation::Pairwise)
+				{
+					Pairwise<T_Sum> _sum;
+
+					forEach([&](const auto& x) { _sum.Add(static_cast<T_Sum>(x)); });
+
+					return _sum.Value();
+				}
+			}
+
+			T_Sum _sum = T_Sum();
+
+			if constexpr (std::is_arithmetic_v<T_Sum>)
+				forEach([&](const auto& x) { _sum = add(_sum, static_cast<T_Sum>(x)); });
+			else
+				forEach([&](const auto& x) { _sum += x; });
+
+			return _sum;
+		}
+
+		// The accumulator Average() uses for T: 64-bit integers, which cannot
+		// overflow on fewer than 2^32 32-bit elements, or at least double
+		template <typename T>
+		using Wide = std::conditional_t<std::floating_point<T>, std::common_type_t<T, double>,
+			std::conditional_t<std::is_signed_v<T>, long long, unsigned long long>>;
+
+		// 'sum' over 'count' in at least double, or 0 when there are no
+		// elements
+		template <typename T_Result, typename T_Sum>
+		constexpr T_Result Mean(T_Sum sum, size_t count)
+		{
+			using T_Divide = std::common_type_t<T_Result, std::conditional_t<std::floating_point<T_Sum>, T_Sum, double>, double>;
+
+			if (count == 0)
+				return T_Result();
+
+			return static_cast<T_Result>(static_cast<T_Divide>(sum) / static_cast<T_Divide>(count));
+		}
+	}  // namespace summation
+}  // namespace linq
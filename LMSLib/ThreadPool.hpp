@@ -0,0 +1,206 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace linq
+{
+	// Fixed-size pool of worker threads with one task deque per worker.
+	// Workers pop from the back of their own deque and steal from the front
+	// of the others once it runs dry, so uneven chunks still keep every
+	// thread busy.
+	class ThreadPool
+	{
+	public:
+		explicit ThreadPool(size_t threads = std::thread::hardware_concurrency())
+			: _queues(threads == 0 ? 1 : threads)
+		{
+			for (size_t i = 0; i < _queues.size(); i++)
+				_workers.emplace_back([this, i] { Work(i); });
+		}
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		~ThreadPool(void)
+		{
+			{
+				std::lock_guard _lock(_mutex);
+				_stopping = true;
+			}
+			_signal.notify_all();
+
+			for (auto& worker : _workers)
+				worker.join();
+		}
+
+		static ThreadPool& Default(void)
+		{
+			static ThreadPool _pool;
+			return _pool;
+		}
+
+		size_t Size(void) const { return _workers.size(); }
+
+		// Runs func(i) for every i in [0, count) and blocks until all of them
+		// have finished. The calling thread steals work while it waits, so
+		// nested calls from inside a task cannot deadlock the pool. The first
+		// exception thrown by a task is rethrown here.
+		template <typename Function>
+		void ParallelFor(size_t count, Function func)
+		{
+			auto _job = std::make_shared<Job>(count);
+
+			for (size_t i = 0; i < count; i++)
+			{
+				Push(i % _queues.size(), [_job, &func, i]
+				{
+					try
+					{
+						func(i);
+					}
+					catch (...)
+					{
+						std::lock_guard _lock(_job->mutex);
+						if (!_job->error)
+							_job->error = std::current_exception();
+					}
+					_job->Finish();
+				});
+			}
+
+			while (!_job->Done())
+			{
+				std::function<void()> _task;
+
+				if (Steal(_queues.size(), _task))
+					_task();
+				else
+					_job->Wait();
+			}
+
+			if (_job->error)
+				std::rethrow_exception(_job->error);
+		}
+
+	private:
+		struct Queue
+		{
+			std::mutex mutex;
+			std::deque<std::function<void()>> tasks;
+		};
+
+		struct Job
+		{
+			explicit Job(size_t count) : remaining(count) {}
+
+			std::mutex mutex;
+			std::condition_variable finished;
+			size_t remaining;
+			std::exception_ptr error;
+
+			void Finish(void)
+			{
+				std::lock_guard _lock(mutex);
+				if (--remaining == 0)
+					finished.notify_all();
+			}
+
+			bool Done(void)
+			{
+				std::lock_guard _lock(mutex);
+				return remaining == 0;
+			}
+
+			void Wait(void)
+			{
+				std::unique_lock _lock(mutex);
+				finished.wait(_lock, [this] { return remaining == 0; });
+			}
+		};
+
+		std::vector<Queue> _queues;
+		std::vector<std::thread> _workers;
+		std::mutex _mutex;
+		std::condition_variable _signal;
+		std::atomic<size_t> _pending = 0;
+		bool _stopping = false;
+
+		void Push(size_t queue, std::function<void()> task)
+		{
+			{
+				std::lock_guard _lock(_queues[queue].mutex);
+				_queues[queue].tasks.push_back(std::move(task));
+			}
+			{
+				std::lock_guard _lock(_mutex);
+				_pending++;
+			}
+			_signal.notify_one();
+		}
+
+		bool Pop(size_t queue, std::function<void()>& task)
+		{
+			std::lock_guard _lock(_queues[queue].mutex);
+
+			if (_queues[queue].tasks.empty())
+				return false;
+
+			task = std::move(_queues[queue].tasks.back());
+			_queues[queue].tasks.pop_back();
+			_pending--;
+
+			return true;
+		}
+
+		// Takes the oldest task of any queue other than 'self'
+		bool Steal(size_t self, std::function<void()>& task)
+		{
+			for (size_t i = 0; i < _queues.size(); i++)
+			{
+				if (i == self)
+					continue;
+
+				std::lock_guard _lock(_queues[i].mutex);
+
+				if (_queues[i].tasks.empty())
+					continue;
+
+				task = std::move(_queues[i].tasks.front());
+				_queues[i].tasks.pop_front();
+				_pending--;
+
+				return true;
+			}
+
+			return false;
+		}
+
+		void Work(size_t self)
+		{
+			while (true)
+			{
+				std::function<void()> _task;
+
+				if (Pop(self, _task) || Steal(self, _task))
+				{
+					_task();
+					continue;
+				}
+
+				std::unique_lock _lock(_mutex);
+				_signal.wait(_lock, [this] { return _stopping || _pending > 0; });
+
+				if (_stopping && _pending == 0)
+					return;
+			}
+		}
+	};
+}  // namespace linq
@@ -0,0 +1,95 @@
+#include "allocations.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+	std::atomic<size_t> allocationCount = 0;
+	std::atomic<size_t> allocationBytes = 0;
+
+	// nullptr when out of memory, for the std::nothrow_t operators
+	void* tryAllocate(size_t size) noexcept
+	{
+		allocationCount.fetch_add(1, std::memory_order_relaxed);
+		allocationBytes.fetch_add(size, std::memory_order_relaxed);
+
+		return std::malloc(size == 0 ? 1 : size);
+	}
+
+	void* allocate(size_t size)
+	{
+		if (auto _pointer = tryAllocate(size))
+			return _pointer;
+
+		throw std::bad_alloc();
+	}
+
+	// Over-aligned blocks are carved out of a larger malloc() block, whose
+	// address is kept right in front of them for the delete operators
+	void* tryAllocateAligned(size_t size, std::align_val_t alignment) noexcept
+	{
+		auto _alignment = static_cast<size_t>(alignment);
+		auto _block = static_cast<char*>(tryAllocate(size + _alignment + sizeof(void*)));
+
+		if (_block == nullptr)
+			return nullptr;
+
+		auto _address = reinterpret_cast<std::uintptr_t>(_block + sizeof(void*));
+		auto _pointer = reinterpret_cast<void**>((_address + _alignment - 1) & ~(_alignment - 1));
+
+		_pointer[-1] = _block;
+
+		return _pointer;
+	}
+
+	void* allocateAligned(size_t size, std::align_val_t alignment)
+	{
+		if (auto _pointer = tryAllocateAligned(size, alignment))
+			return _pointer;
+
+		throw std::bad_alloc();
+	}
+
+	void freeAligned(void* pointer)
+	{
+		if (pointer != nullptr)
+			std::free(static_cast<void**>(pointer)[-1]);
+	}
+}  // namespace
+
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { std::free(pointer); }
+
+void* operator new(size_t size, std::align_val_t alignment) { return allocateAligned(size, alignment); }
+void* operator new[](size_t size, std::align_val_t alignment) { return allocateAligned(size, alignment); }
+void operator delete(void* pointer, std::align_val_t) noexcept { freeAligned(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { freeAligned(pointer); }
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept { freeAligned(pointer); }
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept { freeAligned(pointer); }
+
+// The std::nothrow_t overloads have to be replaced as well, or blocks from
+// the default ones reach the std::free() above
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return tryAllocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return tryAllocate(size); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { std::free(pointer); }
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return tryAllocateAligned(size, alignment); }
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return tryAllocateAligned(size, alignment); }
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { freeAligned(pointer); }
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { freeAligned(pointer); }
+
+namespace linq
+{
+	AllocationStats allocationStats(void)
+	{
+		return { allocationCount.load(), allocationBytes.load() };
+	}
+}  // namespace linq
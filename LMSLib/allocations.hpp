@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+
+namespace linq
+{
+	// Heap allocations made through the global operator new since startup,
+	// counted by the replacement operators in allocations.cpp
+	struct AllocationStats
+	{
+		size_t count;
+		size_t bytes;
+	};
+
+	AllocationStats allocationStats(void);
+}  // namespace linq
@@ -0,0 +1,1267 @@
+#include "benchmarks.hpp"
+
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <compare>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <numeric>
+#include <ranges>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "allocations.hpp"
+#include "Enumerable.hpp"
+
+namespace
+{
+	// A record the size of a cache line, compared and hashed by id
+	struct Pod64
+	{
+		long long id;
+		char payload[56];
+
+		auto operator<=>(const Pod64& other) const { return id <=> other.id; }
+		bool operator==(const Pod64& other) const { return id == other.id; }
+	};
+}  // namespace
+
+template <>
+struct std::hash<Pod64>
+{
+	size_t operator()(const Pod64& x) const noexcept { return std::hash<long long>()(x.id); }
+};
+
+namespace linq
+{
+	namespace
+	{
+		// An int that never uses the inline buffer, like every sequence did
+		// before Enumerable had one
+		struct HeapInt
+		{
+			int value;
+		};
+	}  // namespace
+
+	template <>
+	struct InlineCapacity<HeapInt> : std::integral_constant<size_t, 0> {};
+
+	namespace
+	{
+		using s_clock = std::chrono::steady_clock;
+
+		// One measurement, reported per run of the benchmarked function
+		struct Result
+		{
+			std::string name;
+			size_t elements;
+			size_t iterations;
+			double ns;
+			double allocations;
+			double bytes;
+		};
+
+		BenchmarkOptions options;
+		std::vector<Result> results;
+		// Name of the running group, empty when the filter skips it
+		std::string currentGroup;
+
+		// Keeps the optimizer from discarding benchmarked results
+		volatile long long sink;
+
+		// Starts a group of measurements over the same input, returns false
+		// when the filter skips it
+		bool group(const std::string& name, const std::string& type, size_t elements)
+		{
+			currentGroup.clear();
+
+			if (name.find(options.filter) == std::string::npos)
+				return false;
+
+			currentGroup = name + "/" + type + "/" + std::to_string(elements);
+
+			std::cout << name << "<" << type << "> (" << elements << " elements)" << std::endl;
+
+			return true;
+		}
+
+		// Runs func() in batches of doubling size until options.minTimeMs
+		// passed, so that small inputs are timed over many runs and large ones
+		// over a single cold run. Allocations are counted over all runs.
+		template <typename Function>
+		void measure(const std::string& name, size_t elements, Function func)
+		{
+			if (currentGroup.empty())
+				return;
+
+			auto minTime = std::chrono::duration<double, std::milli>(options.minTimeMs);
+			size_t iterations = 0, batch = 1;
+
+			auto allocations = allocationStats();
+			auto begin = s_clock::now();
+			auto elapsed = s_clock::duration();
+
+			while (true)
+			{
+				for (size_t i = 0; i < batch; i++)
+					sink = static_cast<long long>(func());
+
+				iterations += batch;
+				elapsed = s_clock::now() - begin;
+
+				if (elapsed >= minTime)
+					break;
+
+				batch = iterations;
+			}
+
+			auto after = allocationStats();
+			Result result{
+				currentGroup.substr(0, currentGroup.find('/')) + "/" + name + currentGroup.substr(currentGroup.find('/')),
+				elements,
+				iterations,
+				static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / iterations,
+				static_cast<double>(after.count - allocations.count) / iterations,
+				static_cast<double>(after.bytes - allocations.bytes) / iterations
+			};
+
+			std::cout << "  " << name << ": " << result.ns / elements << " ns/element, "
+				<< result.allocations << " allocations, " << result.bytes << " bytes ("
+				<< iterations << " runs)" << std::endl;
+
+			results.push_back(std::move(result));
+		}
+
+		// Scenario sizes are fixed, but never above options.maxSize
+		size_t capped(size_t count) { return std::min(count, options.maxSize); }
+
+		// Writes the results in the layout of Google Benchmark's JSON
+		// reporter, one entry per measurement named group/variant/type/size,
+		// so that runs of different commits can be compared with its tools
+		void writeJson(const std::string& path)
+		{
+			std::ofstream file(path);
+
+			if (!file)
+				throw std::runtime_error("runBenchmarks() : Could not open '" + path + "'");
+
+			char date[32];
+			auto now = std::time(nullptr);
+			std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+			file << "{\n  \"context\": {\n"
+				<< "    \"date\": \"" << date << "\",\n"
+				<< "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n"
+				<< "    \"simd\": \"" << (simd::level() == simd::Level::AVX2 ? "AVX2" : simd::level() == simd::Level::SSE2 ? "SSE2" : "scalar") << "\",\n"
+#ifdef NDEBUG
+				<< "    \"library_build_type\": \"release\"\n"
+#else
+				<< "    \"library_build_type\": \"debug\"\n"
+#endif
+				<< "  },\n  \"benchmarks\": [";
+
+			for (size_t i = 0; i < results.size(); i++)
+			{
+				const auto& x = results[i];
+
+				file << (i == 0 ? "\n" : ",\n") << "    {\n"
+					<< "      \"name\": \"" << x.name << "\",\n"
+					<< "      \"run_type\": \"iteration\",\n"
+					<< "      \"iterations\": " << x.iterations << ",\n"
+					<< "      \"real_time\": " << x.ns << ",\n"
+					<< "      \"cpu_time\": " << x.ns << ",\n"
+					<< "      \"time_unit\": \"ns\",\n"
+					<< "      \"elements\": " << x.elements << ",\n"
+					<< "      \"ns_per_element\": " << x.ns / x.elements << ",\n"
+					<< "      \"allocations_per_op\": " << x.allocations << ",\n"
+					<< "      \"bytes_per_op\": " << x.bytes << "\n"
+					<< "    }";
+			}
+
+			file << "\n  ]\n}\n";
+		}
+
+		// Inputs of the operator benchmarks. make(v) creates the element of
+		// value v, bucket() maps it into one of 16 groups and key() is what
+		// the ordering and dictionary benchmarks sort and hash by.
+		template <typename T>
+		struct Element;
+
+		template <>
+		struct Element<int>
+		{
+			static constexpr const char* name = "int";
+
+			static int make(size_t v) { return static_cast<int>(v); }
+			static int bucket(int x) { return x & 15; }
+			static int key(int x) { return x; }
+		};
+
+		template <>
+		struct Element<double>
+		{
+			static constexpr const char* name = "double";
+
+			static double make(size_t v) { return static_cast<double>(v) + 0.5; }
+			static int bucket(double x) { return static_cast<int>(x) & 15; }
+			static double key(double x) { return x; }
+		};
+
+		// Long enough to never fit in the small string buffer
+		template <>
+		struct Element<std::string>
+		{
+			static constexpr const char* name = "string";
+
+			static std::string make(size_t v) { return "benchmark element " + std::to_string(v); }
+			static int bucket(const std::string& x) { return x.back() & 15; }
+			static const std::string& key(const std::string& x) { return x; }
+		};
+
+		template <>
+		struct Element<Pod64>
+		{
+			static constexpr const char* name = "pod64";
+
+			static Pod64 make(size_t v)
+			{
+				Pod64 x{ static_cast<long long>(v), {} };
+				std::memset(x.payload, static_cast<int>(v & 0x7F), sizeof(x.payload));
+				return x;
+			}
+			static int bucket(const Pod64& x) { return static_cast<int>(x.id & 15); }
+			static long long key(const Pod64& x) { return x.id; }
+		};
+
+		// Every operator of Enumerable that touches all elements, against a
+		// hand-written STL loop and, where C++20 has one, a std::ranges
+		// pipeline computing the same result. Half of the values repeat and
+		// the second input overlaps the first by half.
+		template <typename T>
+		void benchmarkOperators(size_t count)
+		{
+			using E = Element<T>;
+
+			std::vector<T> data, other;
+			std::vector<int> dimension(16);
+
+			data.reserve(count);
+			other.reserve(count);
+			for (size_t i = 0; i < count; i++)
+			{
+				data.push_back(E::make((i * 2654435761u) % (count / 2 + 1)));
+				other.push_back(E::make((i * 2654435761u) % (count / 2 + 1) + count / 4));
+			}
+			std::iota(std::begin(dimension), std::end(dimension), 0);
+
+			auto enumerable = Enumerable<T>::View(data);
+			auto second = Enumerable<T>::View(other);
+			auto dimensionEnum = Enumerable<int>::View(dimension);
+
+			const auto absent = E::make(count * 2);
+			const auto target = data.back();
+
+			auto pass = [](const T& x) { return E::bucket(x) < 8; };
+			auto bucket = [](const T& x) { return E::bucket(x); };
+			auto key = [](const T& x) -> decltype(auto) { return E::key(x); };
+			auto isAbsent = [&](const T& x) { return x == absent; };
+			auto isPresent = [&](const T& x) { return !(x == absent); };
+			auto isTarget = [&](const T& x) { return x == target; };
+			auto byKey = [](const T& x, const T& y) { return E::key(x) < E::key(y); };
+
+			auto run = [&](const std::string& name, auto linqFunc, auto stlFunc, auto rangesFunc)
+			{
+				if (!group(name, E::name, count))
+					return;
+
+				measure("linq", count, linqFunc);
+				measure("stl", count, stlFunc);
+				if constexpr (!std::is_null_pointer_v<decltype(rangesFunc)>)
+					measure("ranges", count, rangesFunc);
+			};
+
+			auto uniqueSet = [&](const std::vector<T>& x)
+			{
+				std::unordered_set<T> set;
+
+				for (const auto& y : x)
+					set.insert(y);
+				return set;
+			};
+
+			if constexpr (std::is_arithmetic_v<T>)
+			{
+				run("Aggregate",
+					[&] { return enumerable.Aggregate([](T x, T y) { return x + y; }); },
+					[&] { return std::accumulate(std::begin(data), std::end(data), T()); },
+					nullptr);
+				run("Sum",
+					[&] { return enumerable.Sum(); },
+					[&]
+					{
+						T sum = T();
+						for (auto x : data)
+							sum += x;
+						return sum;
+					},
+					nullptr);
+				run("MinMax",
+					[&] { return enumerable.MinMax().second; },
+					[&] { return *std::minmax_element(std::begin(data), std::end(data)).second; },
+					[&] { return std::ranges::minmax(data).max; });
+			}
+
+			run("All",
+				[&] { return enumerable.All(isPresent); },
+				[&] { return std::all_of(std::begin(data), std::end(data), isPresent); },
+				[&] { return std::ranges::all_of(data, isPresent); });
+			run("Any",
+				[&] { return enumerable.Any(isAbsent); },
+				[&] { return std::any_of(std::begin(data), std::end(data), isAbsent); },
+				[&] { return std::ranges::any_of(data, isAbsent); });
+			run("Append",
+				[&] { return enumerable.Append(absent).Count(); },
+				[&]
+				{
+					std::vector<T> out;
+					out.reserve(data.size() + 1);
+					out.insert(std::end(out), std::begin(data), std::end(data));
+					out.push_back(absent);
+					return out.size();
+				},
+				nullptr);
+			run("AsLazy",
+				[&] { return enumerable.AsLazy().Where(pass).Select(bucket).Sum(); },
+				[&]
+				{
+					int sum = 0;
+					for (const auto& x : data)
+						if (pass(x))
+							sum += bucket(x);
+					return sum;
+				},
+				[&]
+				{
+					int sum = 0;
+					for (auto x : data | std::views::filter(pass) | std::views::transform(bucket))
+						sum += x;
+					return sum;
+				});
+			run("AsParallel",
+				[&] { return enumerable.AsParallel().Count(pass); },
+				[&] { return std::count_if(std::begin(data), std::end(data), pass); },
+				[&] { return std::ranges::count_if(data, pass); });
+			run("Concat",
+				[&] { return enumerable.Concat(second).Count(); },
+				[&]
+				{
+					std::vector<T> out;
+					out.reserve(data.size() + other.size());
+					out.insert(std::end(out), std::begin(data), std::end(data));
+					out.insert(std::end(out), std::begin(other), std::end(other));
+					return out.size();
+				},
+				[&]
+				{
+					std::array<std::span<const T>, 2> parts{ std::span<const T>(data), std::span<const T>(other) };
+					std::vector<T> out;
+					std::ranges::copy(parts | std::views::join, std::back_inserter(out));
+					return out.size();
+				});
+			run("Contains",
+				[&] { return enumerable.Contains(absent); },
+				[&] { return std::find(std::begin(data), std::end(data), absent) != std::end(data); },
+				[&] { return std::ranges::find(data, absent) != std::end(data); });
+			run("CountBy",
+				[&] { return enumerable.CountBy(bucket).Count(); },
+				[&]
+				{
+					std::unordered_map<int, int> counts;
+					for (const auto& x : data)
+						counts[bucket(x)]++;
+					return counts.size();
+				},
+				nullptr);
+			run("Distinct",
+				[&] { return enumerable.Distinct().Count(); },
+				[&]
+				{
+					std::unordered_set<T> seen;
+					std::vector<T> out;
+					for (const auto& x : data)
+						if (seen.insert(x).second)
+							out.push_back(x);
+					return out.size();
+				},
+				nullptr);
+			run("Except",
+				[&] { return enumerable.Except(second).Count(); },
+				[&]
+				{
+					auto excluded = uniqueSet(other);
+					std::vector<T> out;
+					for (const auto& x : data)
+						if (excluded.insert(x).second)
+							out.push_back(x);
+					return out.size();
+				},
+				nullptr);
+			run("First",
+				[&] { return bucket(enumerable.First(isTarget)); },
+				[&] { return bucket(*std::find_if(std::begin(data), std::end(data), isTarget)); },
+				[&] { return bucket(*std::ranges::find_if(data, isTarget)); });
+			run("GroupJoin",
+				[&] { return dimensionEnum.GroupJoin(enumerable, [](int x) { return x; }, bucket, [](int, auto matches) { return matches.Count(); }).Count(); },
+				[&]
+				{
+					std::unordered_map<int, std::vector<const T*>> table;
+					std::vector<size_t> out;
+					for (const auto& x : data)
+						table[bucket(x)].push_back(&x);
+					for (auto x : dimension)
+						out.push_back(table[x].size());
+					return out.size();
+				},
+				nullptr);
+			run("Intersect",
+				[&] { return enumerable.Intersect(second).Count(); },
+				[&]
+				{
+					auto included = uniqueSet(other);
+					std::vector<T> out;
+					for (const auto& x : data)
+						if (included.erase(x) != 0)
+							out.push_back(x);
+					return out.size();
+				},
+				nullptr);
+			run("Join",
+				[&] { return enumerable.Join(dimensionEnum, bucket, [](int x) { return x; }, [](const T&, int y) { return y; }).Count(); },
+				[&]
+				{
+					std::unordered_multimap<int, int> table;
+					std::vector<int> out;
+					for (auto x : dimension)
+						table.emplace(x, x);
+					for (const auto& x : data)
+					{
+						auto [first, last] = table.equal_range(bucket(x));
+						for (; first != last; ++first)
+							out.push_back(first->second);
+					}
+					return out.size();
+				},
+				nullptr);
+			run("Last",
+				[&] { return bucket(enumerable.Last(isTarget)); },
+				[&] { return bucket(*std::find_if(std::rbegin(data), std::rend(data), isTarget)); },
+				[&] { return bucket(*std::ranges::find_if(data | std::views::reverse, isTarget)); });
+			run("Max",
+				[&] { return bucket(enumerable.Max()); },
+				[&] { return bucket(*std::max_element(std::begin(data), std::end(data))); },
+				[&] { return bucket(std::ranges::max(data)); });
+			run("OrderBy",
+				[&] { return enumerable.OrderBy(key).ToVector().size(); },
+				[&]
+				{
+					auto out = data;
+					std::stable_sort(std::begin(out), std::end(out), byKey);
+					return out.size();
+				},
+				[&]
+				{
+					auto out = data;
+					std::ranges::stable_sort(out, std::less<>(), key);
+					return out.size();
+				});
+			run("OrderBy.Take",
+				[&] { return enumerable.OrderBy(key).Take(10).Count(); },
+				[&]
+				{
+					std::vector<T> out(std::min<size_t>(10, data.size()));
+					std::partial_sort_copy(std::begin(data), std::end(data), std::begin(out), std::end(out), byKey);
+					return out.size();
+				},
+				[&]
+				{
+					std::vector<T> out(std::min<size_t>(10, data.size()));
+					std::ranges::partial_sort_copy(data, out, std::less<>(), key, key);
+					return out.size();
+				});
+			run("Prepend",
+				[&] { return enumerable.Prepend(absent).Count(); },
+				[&]
+				{
+					std::vector<T> out;
+					out.reserve(data.size() + 1);
+					out.push_back(absent);
+					out.insert(std::end(out), std::begin(data), std::end(data));
+					return out.size();
+				},
+				nullptr);
+			run("Reverse",
+				[&] { return enumerable.Reverse().Count(); },
+				[&] { return std::vector<T>(std::rbegin(data), std::rend(data)).size(); },
+				[&]
+				{
+					std::vector<T> out;
+					std::ranges::copy(data | std::views::reverse, std::back_inserter(out));
+					return out.size();
+				});
+			run("Select",
+				[&] { return enumerable.Select(bucket).Count(); },
+				[&]
+				{
+					std::vector<int> out;
+					out.reserve(data.size());
+					for (const auto& x : data)
+						out.push_back(bucket(x));
+					return out.size();
+				},
+				[&]
+				{
+					auto view = data | std::views::transform(bucket);
+					return std::vector<int>(std::begin(view), std::end(view)).size();
+				});
+			run("SequenceEqual",
+				[&] { return enumerable.SequenceEqual(Enumerable<T>::View(data)); },
+				[&] { return std::equal(std::begin(data), std::end(data), std::begin(data), std::end(data)); },
+				[&] { return std::ranges::equal(data, data); });
+			run("Skip.Take",
+				[&] { return enumerable.Skip(int(count / 4)).Take(int(count / 2)).Count(); },
+				[&] { return std::vector<T>(std::begin(data) + count / 4, std::begin(data) + count / 4 + count / 2).size(); },
+				[&]
+				{
+					auto view = data | std::views::drop(count / 4) | std::views::take(count / 2);
+					return std::vector<T>(std::begin(view), std::end(view)).size();
+				});
+			run("SkipWhile",
+				[&] { return enumerable.SkipWhile(isPresent).Count(); },
+				[&] { return std::vector<T>(std::find_if_not(std::begin(data), std::end(data), isPresent), std::end(data)).size(); },
+				[&]
+				{
+					std::vector<T> out;
+					std::ranges::copy(data | std::views::drop_while(isPresent), std::back_inserter(out));
+					return out.size();
+				});
+			run("TakeWhile",
+				[&] { return enumerable.TakeWhile(isPresent).Count(); },
+				[&] { return std::vector<T>(std::begin(data), std::find_if_not(std::begin(data), std::end(data), isPresent)).size(); },
+				[&]
+				{
+					std::vector<T> out;
+					std::ranges::copy(data | std::views::take_while(isPresent), std::back_inserter(out));
+					return out.size();
+				});
+			run("ToDictionary",
+				[&] { return enumerable.Distinct().ToDictionary(key).size(); },
+				[&]
+				{
+					std::unordered_map<std::remove_cvref_t<decltype(key(data[0]))>, T> map;
+					for (const auto& x : data)
+						map.emplace(key(x), x);
+					return map.size();
+				},
+				nullptr);
+			run("ToLookup",
+				[&] { return enumerable.ToLookup(bucket).Count(); },
+				[&]
+				{
+					std::unordered_map<int, std::vector<T>> groups;
+					for (const auto& x : data)
+						groups[bucket(x)].push_back(x);
+					return groups.size();
+				},
+				nullptr);
+			run("Union",
+				[&] { return enumerable.Union(second).Count(); },
+				[&]
+				{
+					std::unordered_set<T> seen;
+					std::vector<T> out;
+					for (const auto* part : { &data, &other })
+						for (const auto& x : *part)
+							if (seen.insert(x).second)
+								out.push_back(x);
+					return out.size();
+				},
+				nullptr);
+			run("Where",
+				[&] { return enumerable.Where(pass).Count(); },
+				[&]
+				{
+					std::vector<T> out;
+					for (const auto& x : data)
+						if (pass(x))
+							out.push_back(x);
+					return out.size();
+				},
+				[&]
+				{
+					std::vector<T> out;
+					std::ranges::copy(data | std::views::filter(pass), std::back_inserter(out));
+					return out.size();
+				});
+			run("Zip",
+				[&] { return enumerable.Zip(second, [](const T& x, const T& y) { return E::bucket(x) + E::bucket(y); }).Count(); },
+				[&]
+				{
+					std::vector<int> out;
+					out.reserve(data.size());
+					for (size_t i = 0; i < data.size(); i++)
+						out.push_back(E::bucket(data[i]) + E::bucket(other[i]));
+					return out.size();
+				},
+				nullptr);
+		}
+
+		// A short query as a request handler runs dozens of, with its
+		// intermediate buffers on the heap, in a fresh Arena and in an Arena
+		// over a buffer that is reused for every query
+		void benchmarkAllocators(void)
+		{
+			auto count = capped(1000);
+
+			if (!group("Allocators", "int", count))
+				return;
+
+			std::vector<int> data(count);
+			std::iota(std::begin(data), std::end(data), 0);
+
+			auto even = [](int x) { return x % 2 == 0; };
+			auto square = [](int x) { return static_cast<long long>(x) * x; };
+
+			measure("std::allocator", count, [&] { return Enumerable<int>::View(data).Where(even).Select(square).ToVector().size(); });
+			measure("Arena", count, [&]
+			{
+				Arena arena;
+				return arena.View(data).Where(even).Select(square).ToVector().size();
+			});
+
+			std::vector<std::byte> buffer(1 << 16);
+
+			measure("Arena reused buffer", count, [&]
+			{
+				Arena arena(buffer);
+				return arena.View(data).Where(even).Select(square).ToVector().size();
+			});
+		}
+
+		// Chains of operators on short inputs, with results kept inline and
+		// with every result on the heap
+		void benchmarkSmallBuffers(void)
+		{
+			for (size_t count : { 1, 4, 16, 64 })
+			{
+				if (!group("SmallBuffers", "int", count))
+					continue;
+
+				std::vector<int> data(count);
+				std::vector<HeapInt> heapData(count);
+
+				for (size_t i = 0; i < count; i++)
+				{
+					data[i] = static_cast<int>(i);
+					heapData[i].value = static_cast<int>(i);
+				}
+
+				Enumerable enumerable(data);
+				Enumerable heapEnum(heapData);
+
+				measure("inline", count, [&]
+				{
+					return enumerable.Where([](int x) { return x % 4 != 3; }).Select([](int x) { return x * 2; }).Reverse().Append(0).Count();
+				});
+				measure("heap", count, [&]
+				{
+					return heapEnum.Where([](HeapInt x) { return x.value % 4 != 3; }).Select([](HeapInt x) { return HeapInt{ x.value * 2 }; })
+						.Reverse().Append(HeapInt{ 0 }).Count();
+				});
+			}
+		}
+
+		// Compares type-erased std::function callables, which is what the API
+		// used to take, against the same lambdas passed as template arguments
+		void benchmarkCallables(void)
+		{
+			auto count = capped(1 << 22);
+
+			std::vector<int> data(count);
+			std::iota(std::begin(data), std::end(data), 0);
+			Enumerable enumerable(data);
+
+			auto add = [](int x, int y) { return x + y; };
+			auto twice = [](int x) { return x * 2; };
+			auto negative = [](int x) { return x < 0; };
+
+			if (!group("Callables", "int", count))
+				return;
+
+			measure("Aggregate std::function", count, [&] { return enumerable.Aggregate(0, std::function<int(int, int)>(add)); });
+			measure("Aggregate template", count, [&] { return enumerable.Aggregate(0, add); });
+			measure("Select std::function", count, [&] { return enumerable.Select(std::function<int(int)>(twice)).Count(); });
+			measure("Select template", count, [&] { return enumerable.Select(twice).Count(); });
+			measure("Any std::function", count, [&] { return enumerable.Any(std::function<bool(int)>(negative)); });
+			measure("Any template", count, [&] { return enumerable.Any(negative); });
+		}
+
+		// Groups a few million events by key through the open-addressing
+		// Lookup, against the usual unordered_map of per-key vectors
+		void benchmarkGrouping(void)
+		{
+			auto count = capped(1 << 22);
+
+			for (size_t keys : { 16, 4096, 1 << 20 })
+			{
+				if (!group("Grouping " + std::to_string(keys) + " keys", "int", count))
+					continue;
+
+				std::vector<int> events(count);
+
+				for (size_t i = 0; i < count; i++)
+					events[i] = static_cast<int>((i * 2654435761u) % keys);
+
+				Enumerable enumerable(events);
+
+				measure("unordered_map<int, vector>", count, [&]
+				{
+					std::unordered_map<int, std::vector<int>> groups;
+
+					for (auto x : events)
+						groups[x].push_back(x);
+					return groups.size();
+				});
+				measure("ToLookup", count, [&] { return enumerable.ToLookup([](int x) { return x; }).Count(); });
+				measure("CountBy", count, [&] { return enumerable.CountBy([](int x) { return x; }).Count(); });
+			}
+		}
+
+		// Joins a large event log against a dimension table that fits in cache
+		// and against one that does not, hashed and partitioned
+		void benchmarkJoin(void)
+		{
+			auto count = capped(1 << 22);
+
+			std::vector<int> events(count);
+
+			for (size_t i = 0; i < count; i++)
+				events[i] = static_cast<int>((i * 2654435761u) % count);
+
+			Enumerable eventEnum(events);
+
+			for (size_t keys : { capped(1 << 12), capped(1 << 22) })
+			{
+				if (!group("Join " + std::to_string(keys) + " keys", "int", count))
+					continue;
+
+				std::vector<int> dimension(keys);
+				std::iota(std::begin(dimension), std::end(dimension), 0);
+				Enumerable dimensionEnum(dimension);
+
+				auto key = [](int x) { return x; };
+				auto result = [](int x, int y) { return x + y; };
+
+				measure("unordered_multimap", count, [&]
+				{
+					std::unordered_multimap<int, int> table;
+					std::vector<int> joined;
+
+					table.reserve(keys);
+					for (auto x : dimension)
+						table.emplace(x, x);
+					for (auto x : events)
+					{
+						auto [first, last] = table.equal_range(x);
+						for (; first != last; ++first)
+							joined.push_back(x + first->second);
+					}
+					return joined.size();
+				});
+				measure("Join Hash", count, [&] { return eventEnum.Join(dimensionEnum, key, key, result, JoinMode::Hash).Count(); });
+				measure("Join Partitioned", count, [&] { return eventEnum.Join(dimensionEnum, key, key, result, JoinMode::Partitioned).Count(); });
+			}
+		}
+
+		// Sorting by an integral key takes the radix sort, by a floating point
+		// key the parallel merge sort. Take() only partially sorts.
+		void benchmarkOrdering(void)
+		{
+			auto count = capped(1 << 22);
+
+			if (!group("Ordering", "int,double", count))
+				return;
+
+			std::vector<int> data(count);
+			std::vector<double> doubles(count);
+
+			for (size_t i = 0; i < count; i++)
+			{
+				data[i] = static_cast<int>(i * 2654435761u);
+				doubles[i] = static_cast<double>(data[i]);
+			}
+
+			Enumerable enumerable(data);
+			Enumerable doubleEnum(doubles);
+
+			measure("std::stable_sort int", count, [&]
+			{
+				auto sorted = data;
+				std::stable_sort(std::begin(sorted), std::end(sorted));
+				return sorted[0];
+			});
+			measure("OrderBy int", count, [&] { return enumerable.OrderBy([](int x) { return x; }).ToVector()[0]; });
+			measure("std::stable_sort double", count, [&]
+			{
+				auto sorted = doubles;
+				std::stable_sort(std::begin(sorted), std::end(sorted));
+				return sorted[0];
+			});
+			measure("OrderBy double", count, [&] { return doubleEnum.OrderBy([](double x) { return x; }).ToVector()[0]; });
+			measure("OrderBy double Take(10)", count, [&] { return doubleEnum.OrderBy([](double x) { return x; }).Take(10).First(); });
+			measure("OrderBy double First()", count, [&] { return doubleEnum.OrderBy([](double x) { return x; }).First(); });
+		}
+
+		// Line throughput of ReadLines() against std::getline over a log file
+		// that is written to the temporary directory first
+		void benchmarkStreaming(void)
+		{
+			auto count = capped(1 << 20);
+
+			if (!group("Streaming", "line", count))
+				return;
+
+			auto path = (std::filesystem::temp_directory_path() / "lmslib_streaming_benchmark").string();
+			{
+				std::ofstream file(path, std::ios::binary);
+				for (size_t i = 0; i < count; i++)
+					file << "2024-01-01T00:00:00Z level=" << (i % 7 == 0 ? "error" : "info") << " event=" << i << "\n";
+			}
+
+			auto isError = [](const std::string& x) { return x.find("level=error") != std::string::npos; };
+
+			measure("std::getline", count, [&]
+			{
+				std::ifstream file(path);
+				std::string line;
+				size_t errors = 0;
+
+				while (std::getline(file, line))
+					errors += isError(line);
+				return errors;
+			});
+			measure("ReadLines", count, [&] { return ReadLines(path).Where(isError).Count(); });
+			measure("Range", count, [&] { return Range(0, int(count)).Where([](int x) { return x % 7 == 0; }).Count(); });
+
+			std::filesystem::remove(path);
+		}
+
+		// Warm start of a dataset, parsed from text against mapped in place
+		void benchmarkStorage(void)
+		{
+			struct Event
+			{
+				long long timestamp;
+				int user;
+				float value;
+			};
+
+			auto count = capped(1 << 20);
+
+			if (!group("Storage", "record", count))
+				return;
+
+			std::vector<Event> events(count);
+			for (size_t i = 0; i < count; i++)
+				events[i] = { static_cast<long long>(i) * 10, static_cast<int>(i % 1000), static_cast<float>(i % 100) };
+
+			auto textPath = (std::filesystem::temp_directory_path() / "lmslib_storage_benchmark.txt").string();
+			auto tablePath = (std::filesystem::temp_directory_path() / "lmslib_storage_benchmark.table").string();
+			{
+				std::ofstream file(textPath, std::ios::binary);
+				for (const auto& x : events)
+					file << x.timestamp << ' ' << x.user << ' ' << x.value << '\n';
+			}
+			Enumerable(events).ToFile(tablePath, &Event::timestamp, &Event::user);
+
+			measure("Parse text", count, [&]
+			{
+				return ReadLines(textPath).Select([](const std::string& x)
+				{
+					Event event{};
+					std::sscanf(x.c_str(), "%lld %d %f", &event.timestamp, &event.user, &event.value);
+					return event;
+				}).ToEnumerable().Count();
+			});
+			measure("MappedTable", count, [&] { return MappedTable<Event>(tablePath).AsEnumerable().Count(); });
+			measure("MappedTable WhereBetween", count, [&]
+			{
+				return MappedTable<Event>(tablePath).WhereBetween(&Event::timestamp, 1'000'000LL, 1'100'000LL).Count();
+			});
+
+			std::filesystem::remove(textPath);
+			std::filesystem::remove(tablePath);
+		}
+
+		void benchmarkParallel(void)
+		{
+			auto count = capped(1 << 23);
+
+			if (!group("Parallel", "double", count))
+				return;
+
+			std::vector<double> data(count);
+			std::iota(std::begin(data), std::end(data), 0.0);
+			Enumerable enumerable(data);
+
+			auto heavy = [](double x) { return std::sqrt(x) * std::log1p(x) > 100.0; };
+
+			measure("Sequential Count", count, [&] { return enumerable.Where(heavy).Count(); });
+
+			for (size_t threads : { 1, 2, 4, 8, 16 })
+			{
+				ThreadPool pool(threads);
+				auto query = enumerable.AsParallel(pool);
+				auto suffix = " (" + std::to_string(threads) + " threads)";
+
+				measure("Count" + suffix, count, [&] { return query.Count(heavy); });
+				measure("Sum" + suffix, count, [&] { return query.Sum(); });
+				measure("Select" + suffix, count, [&] { return query.Select([](double x) { return x * 0.5; }).Count(); });
+			}
+		}
+
+		// Keeping a filtered sum and a group table current over a large
+		// collection after every batch of inserts, by rescanning it against
+		// maintaining the results incrementally. Each run adds a batch and
+		// takes it out again, so the collection keeps its size.
+		void benchmarkIncremental(void)
+		{
+			auto count = capped(1 << 20);
+			constexpr size_t batch = 100;
+
+			if (!group("Incremental", "int", batch))
+				return;
+
+			std::vector<int> data(count), inserts(batch);
+			for (size_t i = 0; i < count; i++)
+				data[i] = static_cast<int>((i * 7919) % 1000);
+			for (size_t i = 0; i < batch; i++)
+				inserts[i] = static_cast<int>(i * 31 % 1000);
+
+			auto even = [](int x) { return x % 2 == 0; };
+			auto twice = [](int x) { return x * 2; };
+			auto bucket = [](int x) { return x % 16; };
+
+			measure("rescan", batch, [&]
+			{
+				data.insert(data.end(), inserts.begin(), inserts.end());
+				auto view = Enumerable<int>::View(data);
+				auto result = view.Where(even).Select(twice).Sum() + view.CountBy(bucket).Count();
+				data.resize(count);
+				return result;
+			});
+
+			ObservableCollection<int> collection(data);
+			auto sum = collection.Observe().Where(even).Select(twice).Sum();
+			auto groups = collection.Observe().GroupBy(bucket);
+
+			measure("incremental", batch, [&]
+			{
+				collection.AddRange(inserts);
+				auto result = sum.Value() + groups.Count();
+				for (size_t i = 0; i < batch; i++)
+					collection.RemoveAt(collection.Count() - 1);
+				return result;
+			});
+		}
+
+		// Terminal operations on lazy queries that the plan rewrites, against
+		// materializing the same query and asking the result
+		void benchmarkQueryPlans(void)
+		{
+			auto count = capped(1 << 20);
+
+			if (!group("QueryPlans", "int", count))
+				return;
+
+			std::vector<int> data(count);
+			for (size_t i = 0; i < count; i++)
+				data[i] = static_cast<int>((i * 2654435761u) % (count / 4 + 1));
+			auto view = Enumerable<int>::View(data);
+			auto query = view.AsLazy();
+
+			auto odd = [](int x) { return x % 2 != 0; };
+			auto key = [](int x) { return -x; };
+
+			measure("OrderBy.First plan", count, [&] { return query.OrderBy(key).First(); });
+			measure("OrderBy.First materialized", count, [&] { return query.OrderBy(key).ToVector().front(); });
+			measure("Where.Reverse.First plan", count, [&] { return query.Where(odd).Reverse().First(); });
+			measure("Where.Reverse.First materialized", count, [&] { return query.Where(odd).ToEnumerable().Reverse().First(); });
+			measure("Distinct.Count plan", count, [&] { return query.Distinct().Count(); });
+			measure("Distinct.Count materialized", count, [&] { return query.ToEnumerable().Distinct().Count(); });
+		}
+
+		// The sketch terminals against the exact answers they estimate, which
+		// need memory in proportion to the distinct or all elements
+		void benchmarkSketches(void)
+		{
+			auto count = capped(1 << 20);
+
+			if (!group("Sketches", "int", count))
+				return;
+
+			std::vector<int> data(count);
+			for (size_t i = 0; i < count; i++)
+				data[i] = static_cast<int>((i * 2654435761u) % (count / 4 + 1)) % (i % 16 == 0 ? 16 : int(count));
+			auto enumerable = Enumerable<int>::View(data);
+
+			measure("ApproxCountDistinct", count, [&] { return enumerable.ApproxCountDistinct(); });
+			measure("ApproxCountDistinct parallel", count, [&] { return enumerable.AsParallel().ApproxCountDistinct(); });
+			measure("Distinct.Count", count, [&] { return enumerable.Distinct().Count(); });
+			measure("ApproxQuantile", count, [&] { return enumerable.ApproxQuantile(0.9); });
+			measure("ApproxQuantile parallel", count, [&] { return enumerable.AsParallel().ApproxQuantile(0.9); });
+			measure("nth_element", count, [&]
+			{
+				auto copy = data;
+				auto nth = copy.begin() + copy.size() * 9 / 10;
+				std::nth_element(copy.begin(), nth, copy.end());
+				return *nth;
+			});
+			measure("TopKFrequent", count, [&] { return enumerable.TopKFrequent(10).First().element; });
+			measure("TopKFrequent parallel", count, [&] { return enumerable.AsParallel().TopKFrequent(10).front().element; });
+			measure("CountBy.OrderByDescending", count, [&]
+			{
+				return enumerable.CountBy([](int x) { return x; }).OrderByDescending([](const auto& x) { return x.second; }).First().first;
+			});
+		}
+
+		// Every summation into float and double against the loops they
+		// replace, for what accuracy costs
+		void benchmarkSummation(void)
+		{
+			auto count = capped(1 << 20);
+
+			if (!group("Summation", "float", count))
+				return;
+
+			std::vector<float> data(count);
+			for (size_t i = 0; i < count; i++)
+				data[i] = static_cast<float>(i % 1000) * 0.001f + (i % 7 == 0 ? 1000.0f : 0.1f);
+			auto enumerable = Enumerable<float>::View(data);
+
+			measure("Sum", count, [&] { return enumerable.Sum(); });
+			measure("Sum Compensated", count, [&] { return enumerable.Sum(Summation::Compensated); });
+			measure("Sum Pairwise", count, [&] { return enumerable.Sum(Summation::Pairwise); });
+			measure("Sum<double>", count, [&] { return enumerable.Sum<double>(); });
+			measure("Sum<double> Compensated", count, [&] { return enumerable.Sum<double>(Summation::Compensated); });
+			measure("Sum<double> Pairwise", count, [&] { return enumerable.Sum<double>(Summation::Pairwise); });
+			measure("lazy Sum<double> Compensated", count, [&] { return enumerable.AsLazy().Sum<double>(Summation::Compensated); });
+			measure("double loop", count, [&]
+			{
+				double sum = 0;
+				for (auto x : data)
+					sum += x;
+				return sum;
+			});
+			measure("Kahan loop", count, [&]
+			{
+				double sum = 0, compensation = 0;
+				for (auto x : data)
+				{
+					auto y = x - compensation;
+					auto next = sum + y;
+					compensation = (next - sum) - y;
+					sum = next;
+				}
+				return sum;
+			});
+		}
+
+		// A query as is against the same query profiled, with and without
+		// counting allocations, for what measuring every operator costs
+		void benchmarkProfiling(void)
+		{
+			auto count = capped(1 << 20);
+
+			if (!group("Profiling", "int", count))
+				return;
+
+			std::vector<int> data(count);
+			for (size_t i = 0; i < count; i++)
+				data[i] = static_cast<int>(i % 1000);
+			auto view = Enumerable<int>::View(data);
+			auto query = view.AsLazy();
+			profiling::Profiler profiler;
+			profiling::Profiler counting(allocationStats);
+
+			auto odd = [](int x) { return x % 2 != 0; };
+			auto twice = [](int x) { return (long long)x * 2; };
+
+			measure("Where.Select.Sum", count, [&] { return query.Where(odd).Select(twice).Sum(); });
+			measure("Where.Select.Sum profiled", count, [&] { return query.Profile(profiler).Where(odd).Select(twice).Sum(); });
+			measure("Where.Select.Sum profiled with allocations", count, [&]
+			{
+				return query.Profile(counting).Where(odd).Select(twice).Sum();
+			});
+		}
+
+		// Rolling aggregates over windows of growing size, which should cost
+		// the same per element for every window, against recomputing each
+		// window, and block-wise against per-element consumption
+		void benchmarkWindows(void)
+		{
+			auto count = capped(1 << 20);
+
+			if (!group("Windows", "int", count))
+				return;
+
+			std::vector<int> data(count);
+			for (size_t i = 0; i < count; i++)
+				data[i] = static_cast<int>((i * 7919) % 1000);
+			auto enumerable = Enumerable<int>::View(data);
+
+			for (int window : { 4, 64, 1024 })
+			{
+				auto suffix = " " + std::to_string(window);
+
+				measure("RollingMax" + suffix, count, [&] { return enumerable.RollingMax(window).Last(); });
+				measure("RollingSum" + suffix, count, [&] { return enumerable.RollingSum(window).Last(); });
+				if (window <= 64)
+					measure("max per window" + suffix, count, [&]
+					{
+						std::vector<int> maxima;
+
+						for (size_t i = 0; i + window <= data.size(); i++)
+							maxima.push_back(*std::max_element(data.begin() + i, data.begin() + i + window));
+
+						return maxima.back();
+					});
+			}
+
+			measure("Sum foreach", count, [&]
+			{
+				long long sum = 0;
+				enumerable.foreach([&](int x) { sum += x; });
+				return sum;
+			});
+			measure("Sum foreachBatch", count, [&]
+			{
+				long long sum = 0;
+				enumerable.foreachBatch([&](std::span<const int> block) { sum += simd::Sum(block); });
+				return sum;
+			});
+		}
+
+		template <typename T>
+		void benchmarkReductions(const std::string& type)
+		{
+			auto count = capped(1 << 22);
+
+			if (!group("Reductions", type, count))
+				return;
+
+			std::vector<T> data(count);
+			for (size_t i = 0; i < count; i++)
+				data[i] = static_cast<T>((i * 7919) % 1000);
+			Enumerable enumerable(data);
+
+			measure("Sum foreach", count, [&] { return enumerable.Aggregate(T(), [](T x, T y) { return x + y; }); });
+			for (auto level : { simd::Level::Scalar, simd::Level::SSE2, simd::Level::AVX2 })
+			{
+				if (level > simd::level())
+					continue;
+
+				auto name = std::string(level == simd::Level::AVX2 ? "AVX2" : level == simd::Level::SSE2 ? "SSE2" : "scalar");
+
+				measure("Sum " + name, count, [&] { return simd::Sum<T>(data, level); });
+				measure("MinMax " + name, count, [&] { return simd::MinMax<T>(data, level).second; });
+			}
+		}
+	}  // namespace
+
+	bool parseBenchmarkOptions(int argc, char* argv[], BenchmarkOptions& options)
+	{
+		for (int i = 0; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			auto equals = arg.find('=');
+
+			if (equals == std::string::npos)
+				return false;
+
+			auto name = arg.substr(0, equals);
+			auto value = arg.substr(equals + 1);
+
+			try
+			{
+				if (name == "--min-size")
+					options.minSize = std::max<size_t>(std::stoull(value), 1);
+				else if (name == "--max-size")
+					options.maxSize = std::stoull(value);
+				else if (name == "--min-time")
+					options.minTimeMs = std::stod(value);
+				else if (name == "--filter")
+					options.filter = value;
+				else if (name == "--json")
+					options.jsonPath = value;
+				else
+					return false;
+			}
+			catch (const std::logic_error&)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void runBenchmarks(const BenchmarkOptions& benchmarkOptions)
+	{
+		options = benchmarkOptions;
+		results.clear();
+
+		std::cout << "Running benchmarks..." << std::endl;
+
+		for (size_t count = options.minSize; count <= options.maxSize; count *= 10)
+		{
+			benchmarkOperators<int>(count);
+			benchmarkOperators<double>(count);
+			benchmarkOperators<std::string>(count);
+			benchmarkOperators<Pod64>(count);
+		}
+
+		benchmarkAllocators();
+		benchmarkCallables();
+		benchmarkGrouping();
+		benchmarkJoin();
+		benchmarkOrdering();
+		benchmarkStorage();
+		benchmarkStreaming();
+		benchmarkParallel();
+		benchmarkSmallBuffers();
+		benchmarkIncremental();
+		benchmarkQueryPlans();
+		benchmarkProfiling();
+		benchmarkSketches();
+		benchmarkSummation();
+		benchmarkWindows();
+		benchmarkReductions<int>("int");
+		benchmarkReductions<long long>("long long");
+		benchmarkReductions<float>("float");
+		benchmarkReductions<double>("double");
+
+		if (!options.jsonPath.empty())
+			writeJson(options.jsonPath);
+	}
+}  // namespace linq
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace linq
+{
+	struct BenchmarkOptions
+	{
+		// The operator benchmarks run on minSize, 10 * minSize, ... up to
+		// maxSize elements; the scenario benchmarks are capped at maxSize
+		size_t minSize = 10;
+		size_t maxSize = 10'000'000;
+		// Every measurement repeats until it took at least this long
+		double minTimeMs = 20.0;
+		// Only groups whose name contains this run
+		std::string filter;
+		// Results are also written here as JSON, if set
+		std::string jsonPath;
+	};
+
+	// Reads --min-size=N, --max-size=N, --min-time=MS, --filter=TEXT and
+	// --json=PATH, returns false on anything else
+	bool parseBenchmarkOptions(int argc, char* argv[], BenchmarkOptions& options);
+
+	void runBenchmarks(const BenchmarkOptions& options = BenchmarkOptions());
+}  // namespace linq
@@ -1,7 +1,37 @@
 #pragma once
 
+#include <concepts>
+#include <functional>
+#include <type_traits>
+
 namespace linq
 {
+	template <typename T>
+	concept Arithmetic = std::integral<T> or std::floating_point<T>;
+
+	template <typename T, typename U>
+	concept Same = std::is_same<T, U>::value;
+
 	template <typename T>
 	concept Number = std::is_integral<T>::value && !std::is_same<T, bool>::value;
+
+	template <typename T>
+	concept Hashable = requires(const T& x) { { std::hash<T>()(x) } -> std::convertible_to<size_t>; };
+
+	template <typename T>
+	concept Ordered = requires(const T& x, const T& y) { { x < y } -> std::convertible_to<bool>; };
+
+	// Callable constraints used in place of std::function parameters, so user
+	// lambdas are inlined instead of being called through type erasure.
+	template <typename Function, typename T>
+	concept Predicate = std::predicate<Function, T>;
+
+	template <typename Function, typename T>
+	concept IndexedPredicate = std::predicate<Function, T, int>;
+
+	template <typename Function, typename T>
+	concept Selector = std::invocable<Function, T> && !std::is_void_v<std::invoke_result_t<Function, T>>;
+
+	template <typename Function, typename T>
+	concept Accumulator = std::invocable<Function, T, T> && std::convertible_to<std::invoke_result_t<Function, T, T>, T>;
 }  // namespace linq
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace linq
+{
+	namespace detail
+	{
+		// Hashes and compares elements through pointers, so set operators can
+		// index the source buffers without copying a single element.
+		template <typename T, typename Hasher>
+		struct IndirectHash
+		{
+			Hasher hasher;
+
+			size_t operator()(const T* x) const { return hasher(*x); }
+		};
+
+		template <typename T, typename Equality>
+		struct IndirectEqual
+		{
+			Equality equality;
+
+			bool operator()(const T* x, const T* y) const { return equality(*x, *y); }
+		};
+
+		template <typename T, typename Hasher = std::hash<T>, typename Equality = std::equal_to<T>, typename Allocator = std::allocator<const T*>>
+		using PointerSet = std::unordered_set<const T*, IndirectHash<T, Hasher>, IndirectEqual<T, Equality>, Allocator>;
+
+		// The nodes and buckets of the set come from 'allocator'
+		template <typename T, typename Hasher, typename Equality, typename Allocator = std::allocator<const T*>>
+		auto makePointerSet(size_t buckets, Hasher hasher, Equality equality, const Allocator& allocator = Allocator())
+		{
+			return PointerSet<T, Hasher, Equality, Allocator>(
+				buckets, IndirectHash<T, Hasher>{ std::move(hasher) }, IndirectEqual<T, Equality>{ std::move(equality) }, allocator
+			);
+		}
+
+		// Open-addressing map from keys to dense ids handed out in order of
+		// first insertion. Slots hold 'id + 1' (0 marks an empty slot) and are
+		// probed linearly; keys live in a flat array indexed by id, so growing
+		// the table never moves a key. Hashes of non-scalar keys are kept next
+		// to them, to skip most equality checks and rehashing; scalar keys
+		// compare faster than an extra cache miss on the stored hash.
+		template <typename T_Key, typename Hasher = std::hash<T_Key>, typename Equality = std::equal_to<T_Key>>
+		class KeyIndex
+		{
+		public:
+			static constexpr size_t NOT_FOUND = static_cast<size_t>(-1);
+
+			explicit KeyIndex(size_t capacity = 0, Hasher hasher = Hasher(), Equality equality = Equality())
+				: _hasher(std::move(hasher)), _equality(std::move(equality))
+			{
+				Rehash(capacity);
+			}
+
+			size_t Size(void) const { return _keys.size(); }
+
+			const std::vector<T_Key>& Keys(void) const { return _keys; }
+
+			size_t Find(const T_Key& key) const
+			{
+				auto _hash = uint64_t(_hasher(key));
+
+				for (auto i = Bucket(_hash); _slots[i] != 0; i = (i + 1) & _mask)
+				{
+					auto _id = _slots[i] - 1;
+					if (SameHash(_id, _hash) && _equality(_keys[_id], key))
+						return _id;
+				}
+
+				return NOT_FOUND;
+			}
+
+			// Returns the id of 'key' and whether it was inserted just now
+			template <typename T_Other>
+			std::pair<size_t, bool> Insert(T_Other&& key)
+			{
+				auto _hash = uint64_t(_hasher(key));
+				auto i = Bucket(_hash);
+
+				for (; _slots[i] != 0; i = (i + 1) & _mask)
+				{
+					auto _id = _slots[i] - 1;
+					if (SameHash(_id, _hash) && _equality(_keys[_id], key))
+						return { _id, false };
+				}
+
+				_keys.emplace_back(std::forward<T_Other>(key));
+				if constexpr (CACHE_HASHES)
+					_hashes.push_back(_hash);
+				_slots[i] = uint32_t(_keys.size());
+
+				// Keep the load factor at or below one half
+				if (_keys.size() * 2 > _slots.size())
+					Rehash(_slots.size());
+
+				return { _keys.size() - 1, true };
+			}
+
+		private:
+			static constexpr bool CACHE_HASHES = !std::is_scalar_v<T_Key>;
+
+			std::vector<T_Key> _keys;
+			std::vector<uint64_t> _hashes;
+			std::vector<uint32_t> _slots;
+			size_t _mask = 0;
+			int _shift = 64;
+			Hasher _hasher;
+			Equality _equality;
+
+			// Fibonacci hashing spreads identity hashes such as std::hash<int>
+			// over the whole table, using the high bits of the product
+			size_t Bucket(uint64_t hash) const { return size_t((hash * 0x9E3779B97F4A7C15ull) >> _shift); }
+
+			bool SameHash(size_t id, uint64_t hash) const
+			{
+				if constexpr (CACHE_HASHES)
+					return _hashes[id] == hash;
+				else
+					return true;
+			}
+
+			uint64_t HashOf(size_t id) const
+			{
+				if constexpr (CACHE_HASHES)
+					return _hashes[id];
+				else
+					return uint64_t(_hasher(_keys[id]));
+			}
+
+			void Rehash(size_t keys)
+			{
+				size_t _size = 16;
+				_shift = 60;
+
+				while (_size < keys * 2)
+				{
+					_size *= 2;
+					_shift--;
+				}
+
+				_slots.assign(_size, 0);
+				_mask = _size - 1;
+				_keys.reserve(keys);
+				if constexpr (CACHE_HASHES)
+					_hashes.reserve(keys);
+
+				for (size_t id = 0; id < _keys.size(); id++)
+				{
+					auto i = Bucket(HashOf(id));
+
+					while (_slots[i] != 0)
+						i = (i + 1) & _mask;
+					_slots[i] = uint32_t(id + 1);
+				}
+			}
+		};
+	}  // namespace detail
+}  // namespace linq
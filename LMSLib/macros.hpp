@@ -5,3 +5,17 @@
 #define USING_BEGIN_END_ using std::begin, std::end
 
 #define CHECK_EMPTY_SOURCE_ InvalidOperationException(__func__)
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define LMS_X86_ 1
+#else
+#define LMS_X86_ 0
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define LMS_TARGET_SSE2_ __attribute__((target("sse2")))
+#define LMS_TARGET_AVX2_ __attribute__((target("avx2")))
+#else
+#define LMS_TARGET_SSE2_
+#define LMS_TARGET_AVX2_
+#endif
@@ -1,10 +1,31 @@
 #include "tests.hpp"
+#include "benchmarks.hpp"
+
+#include <iostream>
+#include <string>
 
 using namespace linq;
 
-int main(void)
+// Runs the tests, or the benchmarks when started with --benchmark
+int main(int argc, char* argv[])
 {
-	runTests();
+	if (argc < 2)
+	{
+		runTests();
+
+		return 0;
+	}
+
+	BenchmarkOptions options;
+
+	if (std::string(argv[1]) != "--benchmark" || !parseBenchmarkOptions(argc - 2, argv + 2, options))
+	{
+		std::cerr << "Usage: " << argv[0] << " [--benchmark [--min-size=N] [--max-size=N] [--min-time=MS] [--filter=TEXT] [--json=PATH]]" << std::endl;
+
+		return 1;
+	}
+
+	runBenchmarks(options);
 
 	return 0;
 }
@@ -2,24 +2,44 @@
 
 #include <iostream>
 #include <string>
-#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <list>
+#include <numeric>
 
 #include <cassert>
+#include <cmath>
+#include <execution>
+#include <thread>
 
+#include "allocations.hpp"
 #include "Enumerable.hpp"
 
 namespace linq
 {
-	void runTests(void)
+	namespace
 	{
-		using s_clock = std::chrono::steady_clock;
+		// Ordered but not hashable, exercises the sort-based set operators
+		struct Ordinal
+		{
+			int value;
 
-		s_clock::time_point begin, end;
+			bool operator<(const Ordinal& other) const { return value < other.value; }
+			bool operator==(const Ordinal& other) const { return value == other.value; }
+		};
 
-		std::cout << "Running tests..." << std::endl;
+		// Trivially copyable record with arithmetic columns, for ToFile()
+		struct Event
+		{
+			long long timestamp;
+			int user;
+			float value;
+		};
+	}  // namespace
 
-		// Start time measurement
-		begin = s_clock::now();
+	void runTests(void)
+	{
+		std::cout << "Running tests..." << std::endl;
 
 		// int initialization
 		std::array list{ 1, 2, 3, 4 };
@@ -40,6 +60,54 @@ namespace linq
 			.foreach([&](int x) { foreachTestVec.push_back(x); });
 		assert(foreachTestVec == foreachCompVec);
 
+		// Test begin()/end(): an Enumerable is a contiguous range whose
+		// iteration holds no state in the sequence, so loops over it nest and
+		// threads can read it concurrently
+		static_assert(std::ranges::contiguous_range<Enumerable<int>>);
+		static_assert(std::ranges::sized_range<const Enumerable<std::string>>);
+		auto iteratorSum = 0;
+		for (int x : enumerable_list)
+			for (int y : enumerable_list)
+				iteratorSum += x * y;
+		assert(iteratorSum == 100);
+		assert(std::ranges::max(enumerable_list) == 4);
+		assert(std::ranges::find(enumerable_sentence, "fox") - enumerable_sentence.begin() == 3);
+		assert(std::ranges::distance(enumerable_list | std::views::filter([](int x) { return x % 2 == 0; })) == 2);
+		assert(std::reduce(std::execution::unseq, enumerable_list.begin(), enumerable_list.end()) == 10);
+		assert(Enumerable<int>::View(enumerable_list).Sum() == 10);
+		assert(enumerable_empty.begin() == enumerable_empty.end());
+		auto concurrentEnum = Enumerable<int>::Range(0, 100'000);
+		std::array<long long, 2> concurrentSums{};
+		std::thread concurrentReader([&] { for (int x : concurrentEnum) concurrentSums[0] += x; });
+		concurrentEnum.foreach([&](int x) { concurrentSums[1] += x; });
+		concurrentReader.join();
+		assert(concurrentSums[0] == 4'999'950'000LL && concurrentSums[1] == concurrentSums[0]);
+
+		// Test foreachWhile()
+		auto foreachWhileCalls = 0;
+		assert(!enumerable_list.foreachWhile([&](int x) { foreachWhileCalls++; return x < 2; }));
+		assert(foreachWhileCalls == 2);
+		assert(enumerable_list.foreachWhile([](int x) { return x < 100; }));
+
+		// Test foreachBatch()
+		std::vector<size_t> batchSizes;
+		auto batchEnum = Enumerable<int>::Range(0, 10);
+		batchEnum.foreachBatch(4, [&](std::span<const int> block) { batchSizes.push_back(block.size()); });
+		assert(batchSizes == std::vector<size_t>({ 4, 4, 2 }));
+		auto batchSum = 0;
+		batchEnum.foreachBatch([&](std::span<const int> block) { batchSum += simd::Sum(block); });
+		assert(batchSum == 45);
+		std::vector<int> batchLazy;
+		batchEnum.AsLazy().Where([](int x) { return x % 2 == 0; }).foreachBatch(2, [&](std::span<const int> block)
+		{
+			batchLazy.push_back(block.front() * 10 + int(block.size()));
+		});
+		assert(batchLazy == std::vector<int>({ 2, 42, 81 }));
+		auto batchThrew = false;
+		try { batchEnum.foreachBatch(0, [](std::span<const int>) {}); }
+		catch (const std::out_of_range&) { batchThrew = true; }
+		assert(batchThrew);
+
 		// Tests Aggregate()
 		assert(enumerable_list.Aggregate([](int x, int y) { return x + y; }) == 10);
 
@@ -52,11 +120,200 @@ namespace linq
 		assert(!enumerable_empty.Any());
 		assert(enumerable_list.Any([](int x) { return x > 3; }));
 		assert(!enumerable_list.Any([](int x) { return x > 100; }));
+		auto anyCalls = 0;
+		assert(enumerable_list.Any([&](int x) { anyCalls++; return x == 2; }));
+		assert(anyCalls == 2);
+		auto allCalls = 0;
+		assert(!enumerable_list.All([&](int x) { allCalls++; return x == 2; }));
+		assert(allCalls == 1);
 
 		// Tests Append()
 		auto appended_enumerable = enumerable_list.Append(5);
 		assert(appended_enumerable.Any([](int x) { return x == 5; }));
 		assert(appended_enumerable.Count() == 5);
+		auto appendLoopEnum = Enumerable<int>::Empty();
+		for (int i = 0; i < 1000; i++)
+			appendLoopEnum = std::move(appendLoopEnum).Append(i);
+		assert(appendLoopEnum.Count() == 1000 && appendLoopEnum.Last() == 999);
+		assert(std::move(appendLoopEnum).Prepend(-1).Concat(enumerable_list).Count() == 1005);
+
+		// Test ApproxCountDistinct(), ApproxQuantile() and TopKFrequent()
+		// against the exact answers, sequential, lazy and merged from chunks
+		std::vector<int> sketchVec(200'000);
+		for (size_t i = 0; i < sketchVec.size(); i++)
+			sketchVec[i] = int((i * 7919) % 50'000);
+		Enumerable sketchEnum(sketchVec);
+		auto sketchDistinct = sketchEnum.ApproxCountDistinct();
+		assert(std::abs(double(sketchDistinct) - 50'000) < 50'000 * 0.05);
+		assert(sketchEnum.AsLazy().ApproxCountDistinct() == sketchDistinct && sketchEnum.AsParallel().ApproxCountDistinct() == sketchDistinct);
+		assert(std::abs(double(Range(0, 100'000).Select([](int x) { return x % 1'000; }).ApproxCountDistinct()) - 1'000) < 1'000 * 0.05);
+		assert(enumerable_list.ApproxCountDistinct() == 4 && enumerable_sentence.ApproxCountDistinct() == 8);
+		assert(enumerable_empty.ApproxCountDistinct() == 0);
+		for (auto q : { 0.1, 0.5, 0.99 })
+		{
+			assert(std::abs(sketchEnum.ApproxQuantile(q) - q * 50'000) < 1'000);
+			assert(std::abs(sketchEnum.AsParallel().ApproxQuantile(q) - q * 50'000) < 1'000);
+		}
+		assert(sketchEnum.ApproxQuantile(0) == 0 && sketchEnum.AsParallel().ApproxQuantile(1) == 49'999);
+		assert(enumerable_list.ApproxQuantile(0.5) == 2 && enumerable_list.AsLazy().ApproxQuantile(0.75) == 3);
+		assert(enumerable_sentence.ApproxQuantile(0.5) == "lazy");
+		auto sketchEmptyThrew = false;
+		try { enumerable_empty.AsLazy().ApproxQuantile(0.5); }
+		catch (const std::runtime_error&) { sketchEmptyThrew = true; }
+		assert(sketchEmptyThrew);
+		std::vector<int> hitterVec;
+		for (int i = 0; i < 10'000; i++)
+		{
+			hitterVec.push_back(100 + i);
+			if (i % 10 == 0)
+				hitterVec.push_back(1);
+			if (i % 20 == 0)
+				hitterVec.push_back(2);
+			if (i % 40 == 0)
+				hitterVec.push_back(3);
+		}
+		std::array hitterCounts{ 1'000, 500, 250 };
+		// 100 counters keep every element occurring more than 11'750 / 100 times
+		auto hitterTop = Enumerable(hitterVec).TopKFrequent(3, 100);
+		auto hitterParallelTop = Enumerable(hitterVec).AsParallel().TopKFrequent(3, 100);
+		for (size_t i = 0; i < hitterCounts.size(); i++)
+		{
+			assert(hitterTop.ElementAt(int(i)).element == int(i) + 1 && hitterParallelTop[i].element == int(i) + 1);
+			assert(hitterTop.ElementAt(int(i)).count >= size_t(hitterCounts[i]) && hitterParallelTop[i].count >= size_t(hitterCounts[i]));
+			assert(hitterTop.ElementAt(int(i)).count - hitterTop.ElementAt(int(i)).error <= size_t(hitterCounts[i]));
+			assert(hitterParallelTop[i].count - hitterParallelTop[i].error <= size_t(hitterCounts[i]));
+		}
+		auto hitterExact = Enumerable(hitterVec).CountBy([](int x) { return x; }).ToDictionary(
+			[](const auto& x) { return x.first; }, [](const auto& x) { return x.second; });
+		for (const auto& hitters : { Enumerable(hitterVec).TopKFrequent(100, 100).ToVector(), Enumerable(hitterVec).AsParallel().TopKFrequent(100, 100) })
+		{
+			assert(hitters.size() == 100);
+			for (const auto& x : hitters)
+				assert(x.count >= size_t(hitterExact[x.element]) && x.count - x.error <= size_t(hitterExact[x.element]));
+		}
+		auto sentenceTop = enumerable_sentence.AsLazy().TopKFrequent(2);
+		assert(sentenceTop.size() == 2 && sentenceTop[0].element == "the" && sentenceTop[0].count == 2 && sentenceTop[0].error == 0);
+		assert(sentenceTop[1].element == "quick" && sentenceTop[1].count == 1);
+
+		// Test that the std::nothrow_t operators are counted too, which e.g.
+		// std::stable_sort() takes its buffer from
+		auto nothrowAllocations = allocationStats().count;
+		auto nothrowBlock = operator new(64, std::nothrow);
+		auto nothrowAligned = operator new(64, std::align_val_t(128), std::nothrow);
+		assert(allocationStats().count == nothrowAllocations + 2 && reinterpret_cast<uintptr_t>(nothrowAligned) % 128 == 0);
+		operator delete(nothrowBlock, std::nothrow);
+		operator delete(nothrowAligned, std::align_val_t(128), std::nothrow);
+
+		// Test Arena, a query over an arena in a stack buffer must not touch
+		// the heap and every operator must keep the allocator
+		std::vector<int> arenaTestVec(1000);
+		std::iota(std::begin(arenaTestVec), std::end(arenaTestVec), 0);
+		std::array<std::byte, 1 << 18> arenaBuffer;
+		{
+			Arena arena(arenaBuffer);
+			auto arenaAllocations = allocationStats().count;
+			auto arenaEnum = arena.View(arenaTestVec);
+			auto arenaResult = arenaEnum.Where([](int x) { return x % 3 == 0; }).Select([](int x) { return x * 2.0; });
+			static_assert(std::is_same_v<decltype(arenaResult), pmr::Enumerable<double>>);
+			assert(arenaResult.Count() == 334 && arenaResult.Last() == 1998.0);
+			assert(arenaEnum.Distinct().Union(arenaEnum.Reverse()).Except(arenaEnum.Take(500)).Count() == 500);
+			assert(std::move(arenaResult).Append(-1.0).Prepend(-2.0).Count() == 336);
+			assert(allocationStats().count == arenaAllocations);
+			assert(arenaEnum.Skip(10).SequenceEqual(Enumerable<int>::View(arenaTestVec).Skip(10)));
+		}
+		pmr::Enumerable<int> pmrTestEnum = pmr::Enumerable<int>::View(arenaTestVec, std::pmr::new_delete_resource());
+		assert(pmrTestEnum.Zip(enumerable_list, [](int x, int y) { return x + y; })
+			.SequenceEqual(Enumerable<int>::Range(1, 4).Select([](int x) { return x * 2 - 1; })));
+		assert(pmrTestEnum.OrderByDescending([](int x) { return x; }).First() == 999);
+		// Moving between resources copies into the target's, which can throw
+		using PmrSmallVector = detail::SmallVector<int, 4, std::pmr::polymorphic_allocator<int>>;
+		static_assert(std::is_nothrow_move_assignable_v<detail::SmallVector<int, 4>>);
+		static_assert(!std::is_nothrow_move_assignable_v<PmrSmallVector>);
+		std::pmr::monotonic_buffer_resource smallVectorResource;
+		PmrSmallVector smallVectorSource(std::begin(arenaTestVec), std::end(arenaTestVec));
+		PmrSmallVector smallVectorTarget(&smallVectorResource);
+		smallVectorTarget = std::move(smallVectorSource);
+		assert(smallVectorTarget.size() == 1000 && smallVectorTarget[999] == 999);
+		assert(smallVectorTarget.get_allocator().resource() == &smallVectorResource);
+
+		// Test AsLazy()
+		std::vector lazyCompVec = { 6, 8 };
+		auto lazyCalls = 0;
+		auto lazyQuery = enumerable_list.AsLazy()
+			.Select([&](int x) { lazyCalls++; return x * 2; })
+			.Where([](int x) { return x > 5; });
+		assert(lazyCalls == 0);
+		assert(lazyQuery.ToVector() == lazyCompVec);
+		assert(lazyQuery.Take(1).First() == 6);
+		assert(lazyCalls == 7);
+		assert(lazyQuery.Prepend(0).Append(9).Count() == 4);
+		assert(enumerable_list.AsLazy().Skip(1).Take(2).Sum() == 5);
+		assert(enumerable_list.AsLazy().TakeWhile([](int x) { return x < 3; })
+			.Concat(enumerable_list.AsLazy().SkipWhile([](int, int i) { return i < 2; }))
+			.ToEnumerable().SequenceEqual(enumerable_list));
+		assert(enumerable_list.AsLazy().Any([](int x) { return x == 2; }));
+		assert(!enumerable_empty.AsLazy().Any());
+
+		// Test the query plan rewrites and Explain()
+		auto planCalls = 0;
+		auto planSelect = [&](int x) { planCalls++; return x * 2; };
+		auto planQuery = enumerable_list.AsLazy().Where([](int x) { return x > 1; }).Where([](int x) { return x < 4; });
+		assert(planQuery.Explain() == "Source(4) -> Where(2 predicates)");
+		assert(planQuery.ToVector() == std::vector({ 2, 3 }));
+		assert(planQuery.Select(planSelect).Count() == 2 && planCalls == 0);
+		assert(planQuery.Select(planSelect).Explain(Terminal::Count) == "Source(4) -> Where(2 predicates) -> Count");
+		assert(enumerable_list.AsLazy().Select(planSelect).Reverse().Count() == 4 && planCalls == 0);
+		assert(enumerable_list.AsLazy().Skip(1).Take(2).Explain() == "Source(2)");
+		assert(enumerable_list.AsLazy().Skip(1).Take(2).ToVector() == std::vector({ 2, 3 }));
+		assert(enumerable_list.AsLazy().Skip(9).Take(2).Count() == 0 && enumerable_list.AsLazy().Take(-1).Count() == 0);
+		assert(enumerable_list.AsLazy().Reverse().Skip(1).ToVector() == std::vector({ 3, 2, 1 }));
+		assert(enumerable_list.AsLazy().Reverse().Reverse().Explain() == "Source(4)");
+		auto planReversed = enumerable_list.AsLazy().Where([](int x) { return x < 4; }).Reverse();
+		assert(planReversed.First() == 3 && planReversed.Last() == 1);
+		assert(planReversed.Explain(Terminal::First) == "Source(4) -> Where -> Last");
+		assert(enumerable_list.AsLazy().Select(planSelect).Last() == 8 && planCalls == 1);
+		assert(enumerable_list.AsLazy().Last() == 4 && enumerable_list.AsLazy().Reverse().Last() == 1);
+		std::array<std::pair<int, char>, 6> planPairs{ { { 2, 'a' }, { 1, 'b' }, { 3, 'c' }, { 1, 'd' }, { 3, 'e' }, { 2, 'f' } } };
+		Enumerable planPairsEnum(planPairs);
+		auto planOrdered = planPairsEnum.AsLazy().OrderBy([](const auto& x) { return x.first; });
+		auto planSorted = planOrdered.ToVector();
+		assert(planOrdered.First() == planSorted.front() && planOrdered.Last() == planSorted.back());
+		assert(planOrdered.First().second == 'b' && planOrdered.Last().second == 'e');
+		auto planDescending = planPairsEnum.AsLazy().OrderByDescending([](const auto& x) { return x.first; });
+		assert(planDescending.First().second == 'c' && planDescending.Last().second == 'd');
+		assert(planDescending.ToVector().front() == planDescending.First() && planDescending.ToVector().back() == planDescending.Last());
+		assert(planOrdered.Explain(Terminal::First) == "Source(6) -> MinBy" && planOrdered.Count() == 6);
+		std::array planDuplicates{ 3, 1, 3, 2, 1, 3 };
+		Enumerable planDuplicatesEnum(planDuplicates);
+		auto planDistinct = planDuplicatesEnum.AsLazy().Distinct();
+		assert(planDistinct.ToVector() == std::vector({ 3, 1, 2 }) && planDistinct.Count() == 3);
+		assert(planDistinct.Explain(Terminal::Count) == "Source(6) -> Distinct -> Count(hash cardinality)");
+		assert(planDuplicatesEnum.AsLazy().Select([](int x) { return x % 2; }).Distinct().Count() == 2);
+		assert(enumerable_sentence.AsLazy().Distinct().Count() == 8);
+		auto planEmptyThrew = false;
+		try { enumerable_empty.AsLazy().OrderBy([](int x) { return x; }).First(); }
+		catch (const std::runtime_error&) { planEmptyThrew = true; }
+		assert(planEmptyThrew);
+
+		// Test AsParallel()
+		std::vector<int> parallelTestVec(100'000);
+		std::iota(std::begin(parallelTestVec), std::end(parallelTestVec), 1);
+		Enumerable parallelTestEnum(parallelTestVec);
+		ThreadPool parallelPool(4);
+		auto parallelQuery = parallelTestEnum.AsParallel(parallelPool);
+		assert(parallelQuery.Select([](int x) { return (long long)x; }).Sum() == 5'000'050'000);
+		assert(parallelQuery.Count([](int x) { return x % 3 == 0; }) == 33'333);
+		assert(parallelQuery.Min() == 1 && parallelQuery.Max() == 100'000);
+		assert(parallelQuery.Any([](int x) { return x == 99'999; }));
+		assert(!parallelQuery.All([](int x) { return x < 99'999; }));
+		assert(parallelQuery.Average() == 50'000.5f);
+		assert(parallelQuery.Aggregate([](int x, int y) { return x > y ? x : y; }) == 100'000);
+		assert(parallelQuery.Select([](int x) { return x * 2; }).Where([](int x) { return x % 4 == 0; })
+			.ToEnumerable().SequenceEqual(parallelTestEnum.Select([](int x) { return x * 2; }).Where([](int x) { return x % 4 == 0; })));
+		assert(parallelQuery.AsUnordered().Where([](int x) { return x > 50'000; }).Sum<long long>() == 3'750'025'000);
+		assert(parallelTestEnum.Where([](int x) { return x > 50'000; }).Sum<long long>() == 3'750'025'000);
+		assert(enumerable_list.AsParallel().Sum() == 10);
+		assert(!enumerable_empty.AsParallel().Any());
 
 		// Test Average()
 		assert(enumerable_list.Average() == 2.5);
@@ -66,6 +323,17 @@ namespace linq
 		Enumerable castTestEnum(castTestList);
 		assert(enumerable_list.Cast<float>().SequenceEqual(castTestEnum));
 
+		// Test Chunk()
+		auto chunkTestEnum = Enumerable<int>::Range(1, 7).Chunk(3);
+		assert(chunkTestEnum.Count() == 3);
+		assert(chunkTestEnum.ElementAt(1).SequenceEqual(Enumerable(std::array{ 4, 5, 6 })));
+		assert(chunkTestEnum.Last().Count() == 1 && chunkTestEnum.Last().First() == 7);
+		std::vector chunkSource{ 1, 2, 3, 4, 5 };
+		auto chunkViews = Enumerable<int>::View(chunkSource).Chunk(2);
+		chunkSource[4] = 50;
+		assert(chunkViews.ElementAt(2).First() == 50);
+		assert(!enumerable_empty.Chunk(5).Any());
+
 		// Test Concat()
 		std::array concatTestList{ 5, 6, 7 };
 		std::array concatCompList{ 1, 2, 3, 4, 5, 6, 7 };
@@ -81,10 +349,29 @@ namespace linq
 		// Tests Count()
 		assert(enumerable_list.Count() == 4);
 
+		// Test CountBy()
+		auto countByTest = enumerable_sentence.CountBy([](const std::string& x) { return x.size(); });
+		assert(countByTest.Count() == 3);
+		assert((countByTest.First() == std::pair<size_t, int>(3, 4)));
+		assert((countByTest.Last() == std::pair<size_t, int>(4, 2)));
+
 		// Test Distinct()
 		std::array distinctTestList{ 1, 1, 2, 3, 3, 4 };
 		Enumerable distinctTestEnum(distinctTestList);
 		assert(enumerable_list.SequenceEqual(distinctTestEnum.Distinct()));
+		std::array distinctModList{ 4, 1, 7, 2, 5 };
+		std::array distinctModCompList{ 4, 2 };
+		Enumerable distinctModEnum(distinctModList);
+		Enumerable distinctModCompEnum(distinctModCompList);
+		assert(distinctModCompEnum.SequenceEqual(distinctModEnum.Distinct(
+			[](int x) { return std::hash<int>()(x % 3); },
+			[](int x, int y) { return x % 3 == y % 3; }
+		)));
+		std::array<Ordinal, 5> ordinalList{ Ordinal{ 3 }, Ordinal{ 1 }, Ordinal{ 3 }, Ordinal{ 2 }, Ordinal{ 1 } };
+		std::array<Ordinal, 3> ordinalDistinctList{ Ordinal{ 3 }, Ordinal{ 1 }, Ordinal{ 2 } };
+		Enumerable ordinalEnum(ordinalList);
+		Enumerable ordinalDistinctEnum(ordinalDistinctList);
+		assert(ordinalDistinctEnum.SequenceEqual(ordinalEnum.Distinct()));
 
 		// Test ElementAt()
 		assert(enumerable_list.ElementAt(0) == 1);
@@ -100,10 +387,51 @@ namespace linq
 		Enumerable exceptTestEnum(exceptTestList);
 		Enumerable exceptCompEnum(exceptCompList);
 		assert(exceptCompEnum.SequenceEqual(enumerable_list.Except(exceptTestEnum)));
+		assert(ordinalEnum.Except(ordinalDistinctEnum.Take(1)).Count() == 2);
 
 		// Test First()
 		assert(enumerable_list.First() == 1);
 		assert(enumerable_list.First([](int x) {return x > 2; }) == 3);
+		auto firstThrew = false;
+		try { enumerable_list.First([](int x) { return x > 100; }); }
+		catch (const std::runtime_error&) { firstThrew = true; }
+		assert(firstThrew);
+
+		// Test FixedEnumerable, evaluated by the compiler
+		constexpr auto fixedTestEnum = FixedEnumerable(std::array{ 5, 3, 8, 1, 9, 3, 7 });
+		constexpr auto fixedOdd = fixedTestEnum.Where([](int x) { return x % 2 != 0; });
+		static_assert(fixedOdd.Count() == 6 && fixedOdd.Sum() == 28 && fixedOdd.Sum<double>(Summation::Compensated) == 28);
+		static_assert(fixedOdd.Contains(9) && !fixedOdd.Contains(8));
+		static_assert(fixedTestEnum.Select([](int x) { return x * 0.5; }).Max() == 4.5);
+		static_assert(fixedTestEnum.OrderBy([](int x) { return x; })
+			.SequenceEqual(FixedEnumerable(std::array{ 1, 3, 3, 5, 7, 8, 9 })));
+		static_assert(fixedTestEnum.OrderByDescending([](int x) { return x % 3; }).Take(3)
+			.SequenceEqual(FixedEnumerable(std::array{ 5, 8, 1 })));
+		static_assert(fixedTestEnum.Distinct().Reverse().Skip(4).ToArray() == std::array{ 3, 5, 0, 0, 0, 0, 0 });
+		static_assert(fixedTestEnum.Aggregate(0, [](int x, int y) { return x > y ? x : y; }) == 9);
+		constexpr auto fixedSquares = FixedEnumerable(std::array{ 0, 1, 2, 3, 4, 5, 6, 7 }).Select([](int x) { return x * x; }).ToArray();
+		static_assert(fixedSquares[7] == 49);
+		assert(fixedTestEnum.Sum() == 36 && fixedTestEnum.ToEnumerable().SequenceEqual(Enumerable(std::array{ 5, 3, 8, 1, 9, 3, 7 })));
+
+		// Test GroupBy()
+		auto groupByTest = enumerable_sentence.GroupBy(
+			[](const std::string& x) { return x[0]; },
+			[](const std::string& x) { return x.size(); },
+			[](char key, Enumerable<size_t> sizes) { return std::string(1, key) + std::to_string(sizes.Sum()); }
+		);
+		std::array<std::string, 8> groupByCompList{ "t6", "q5", "b5", "f3", "j5", "o4", "l4", "d3" };
+		assert(groupByTest.SequenceEqual(Enumerable(groupByCompList)));
+		auto groupByParity = enumerable_list.GroupBy([](int x) { return x % 2; });
+		assert(groupByParity.Count() == 2);
+		assert(groupByParity[0].SequenceEqual(Enumerable(std::vector{ 2, 4 })));
+
+		// Test GroupJoin()
+		auto groupJoinTest = enumerable_list.GroupJoin(enumerable_sentence,
+			[](int x) { return size_t(x); },
+			[](const std::string& x) { return x.size(); },
+			[](int x, Enumerable<std::string> words) { return words.Count() * 10 + x; }
+		);
+		assert(groupJoinTest.SequenceEqual(Enumerable(std::vector{ 1, 2, 43, 24 })));
 
 		// Test Intersect()
 		std::array intersectTestList{ 1, 3, 999 };
@@ -111,6 +439,61 @@ namespace linq
 		Enumerable intersectTestEnum(intersectTestList);
 		Enumerable intersectCompEnum(intersectCompList);
 		assert(intersectCompEnum.SequenceEqual(enumerable_list.Intersect(intersectTestEnum)));
+		assert(intersectCompEnum.SequenceEqual(distinctTestEnum.Intersect(intersectTestEnum)));
+		assert(ordinalEnum.Intersect(ordinalDistinctEnum.Skip(1)).Count() == 2);
+
+		// Test Join(), building on either side and partitioned, against nested loops
+		auto joinTest = enumerable_list.Join(enumerable_sentence,
+			[](int x) { return size_t(x); },
+			[](const std::string& x) { return x.size(); },
+			[](int x, const std::string& word) { return std::to_string(x) + word; }
+		);
+		std::array<std::string, 6> joinCompList{ "3the", "3fox", "3the", "3dog", "4over", "4lazy" };
+		assert(joinTest.SequenceEqual(Enumerable(joinCompList)));
+		auto joinReversed = enumerable_sentence.Join(enumerable_list,
+			[](const std::string& x) { return int(x.size()); },
+			[](int x) { return x; },
+			[](const std::string& word, int x) { return word + std::to_string(x); }
+		);
+		std::array<std::string, 6> joinReversedCompList{ "the3", "fox3", "over4", "the3", "lazy4", "dog3" };
+		assert(joinReversed.SequenceEqual(Enumerable(joinReversedCompList)));
+		std::vector<int> joinOuterList(20'000), joinInnerList(50'000);
+		for (size_t i = 0; i < joinOuterList.size(); i++)
+			joinOuterList[i] = static_cast<int>((i * 7919) % 30'000);
+		for (size_t i = 0; i < joinInnerList.size(); i++)
+			joinInnerList[i] = static_cast<int>((i * 104729) % 60'000);
+		std::vector<std::pair<size_t, size_t>> joinReference;
+		std::vector<std::vector<size_t>> joinInnerIndex(60'000);
+		for (size_t i = 0; i < joinInnerList.size(); i++)
+			joinInnerIndex[joinInnerList[i]].push_back(i);
+		for (size_t o = 0; o < joinOuterList.size(); o++)
+			for (auto i : joinInnerIndex[joinOuterList[o]])
+				joinReference.emplace_back(o, i);
+		auto joinIndexed = [](Enumerable<int> source)
+		{
+			std::vector<std::pair<int, size_t>> indexed;
+			source.foreach([&](int x) { indexed.emplace_back(x, indexed.size()); });
+			return Enumerable(indexed);
+		};
+		auto joinOuter = joinIndexed(Enumerable(joinOuterList));
+		auto joinInner = joinIndexed(Enumerable(joinInnerList));
+		for (auto mode : { JoinMode::Hash, JoinMode::Partitioned })
+		{
+			auto joinLarge = joinOuter.Join(joinInner,
+				[](const auto& x) { return x.first; },
+				[](const auto& x) { return x.first; },
+				[](const auto& x, const auto& y) { return std::pair(x.second, y.second); },
+				mode
+			);
+			assert(joinLarge.ToVector() == joinReference);
+			auto joinLargeReversed = joinInner.Join(joinOuter,
+				[](const auto& x) { return x.first; },
+				[](const auto& x) { return x.first; },
+				[](const auto& x, const auto& y) { return std::pair(y.second, x.second); },
+				mode
+			);
+			assert(joinLargeReversed.Count() == int(joinReference.size()));
+		}
 
 		// Test Last()
 		assert(enumerable_list.Last() == 4);
@@ -122,25 +505,270 @@ namespace linq
 		// Test Min()
 		assert(enumerable_list.Min() == 1);
 
+		// Test MinMax()
+		assert(enumerable_list.MinMax() == std::pair(1, 4));
+		assert((enumerable_sentence.MinMax() == std::pair<std::string, std::string>("brown", "the")));
+
+		// Test ObservableCollection: results materialized from Observe() follow
+		// appends and removals, matching a full recomputation every time
+		ObservableCollection<int> observed(std::vector{ 5, 12, 7, 30 });
+		auto observedQuery = observed.Observe().Where([](int x) { return x % 3 != 0; }).Select([](int x) { return x * 2; });
+		auto observedSum = observedQuery.Sum();
+		auto observedCount = observedQuery.Count();
+		auto observedMax = observedQuery.Max();
+		auto observedMin = observedQuery.Min();
+		auto observedAverage = observedQuery.Average();
+		auto observedGroups = observed.Observe().GroupBy([](int x) { return x % 4; });
+		auto observedGroupMax = observed.Observe().GroupBy([](int x) { return x % 4; }, incremental::Max());
+		auto checkObserved = [&]
+		{
+			auto expected = observed.AsEnumerable().Where([](int x) { return x % 3 != 0; }).Select([](int x) { return x * 2; });
+			assert(observedSum.Value() == expected.Sum());
+			assert(observedCount.Value() == expected.Count());
+			assert(observedAverage.Value() == expected.Average());
+			if (expected.Any())
+				assert(observedMax.Value() == expected.Max() && observedMin.Value() == expected.Min());
+			auto expectedGroups = observed.AsEnumerable().CountBy([](int x) { return x % 4; });
+			assert(observedGroups.Count() == expectedGroups.Count());
+			for (const auto& [key, count] : expectedGroups)
+			{
+				assert(observedGroups.Value(key) == count);
+				assert(observedGroupMax.Value(key) == observed.AsEnumerable().Where([&](int x) { return x % 4 == key; }).Max());
+			}
+		};
+		checkObserved();
+		observed.AddRange(std::vector{ 40, 1, 40, 9 });
+		checkObserved();
+		assert(observedMax.Value() == 80 && observedMin.Value() == 2);
+		assert(observed.Remove(40) && !observed.Remove(41));
+		checkObserved();
+		assert(observedMax.Value() == 80);
+		observed.Remove(40);
+		observed.RemoveAt(0);
+		checkObserved();
+		assert(observedMax.Value() == 14 && observedGroupMax.Value(0) == 12);
+		observed.Add(3);
+		observed.Remove(1);
+		checkObserved();
+		assert(observedGroups.Value(3) == 2 && observedGroups.Contains(2));
+		observed.Remove(30);
+		checkObserved();
+		assert(!observedGroups.Contains(2));
+		// Sums wrap like Enumerable<T>::Sum(), also when removing INT_MIN
+		ObservableCollection<int> observedWrapping(std::vector{ INT_MAX });
+		auto observedWrappingSum = observedWrapping.Observe().Sum();
+		observedWrapping.Add(1);
+		assert(observedWrappingSum.Value() == INT_MIN && observedWrappingSum.Value() == observedWrapping.AsEnumerable().Sum());
+		observedWrapping.Add(INT_MIN);
+		observedWrapping.Remove(INT_MIN);
+		observedWrapping.Remove(1);
+		assert(observedWrappingSum.Value() == INT_MAX);
+		{
+			auto observedTemporary = observed.Observe().Count();
+			assert(observedTemporary.Value() == observed.Count());
+		}
+		observed.Clear();
+		checkObserved();
+		assert(observedSum.Value() == 0 && observedGroups.Count() == 0);
+		auto observedThrew = false;
+		try { observedMax.Value(); }
+		catch (const std::runtime_error&) { observedThrew = true; }
+		assert(observedThrew);
+
+		// Test OrderBy(), OrderByDescending(), ThenBy() and ThenByDescending()
+		auto orderByTest = enumerable_sentence.OrderBy([](const std::string& x) { return x.size(); })
+			.ThenBy([](const std::string& x) { return x; });
+		std::array<std::string, 9> orderByCompList{ "dog", "fox", "the", "the", "lazy", "over", "brown", "jumps", "quick" };
+		assert(orderByTest.ToEnumerable().SequenceEqual(Enumerable(orderByCompList)));
+		assert(orderByTest.First() == "dog" && orderByTest.Last() == "quick");
+		assert(orderByTest.Take(3).SequenceEqual(Enumerable(orderByCompList).Take(3)));
+		auto orderByDescendingTest = enumerable_sentence.OrderByDescending([](const std::string& x) { return x.size(); })
+			.ThenByDescending([](const std::string& x) { return x[0]; });
+		assert(orderByDescendingTest.First() == "quick" && orderByDescendingTest.Last() == "dog");
+		// Stability, equal keys keep their source order
+		std::array<std::pair<int, int>, 5> orderByStableList{ { { 2, 0 }, { 1, 1 }, { 2, 2 }, { 1, 3 }, { -1, 4 } } };
+		auto orderByStable = Enumerable(orderByStableList).OrderBy([](const std::pair<int, int>& x) { return x.first; }).ToEnumerable()
+			.Select([](const std::pair<int, int>& x) { return x.second; });
+		assert(orderByStable.SequenceEqual(Enumerable(std::vector{ 4, 1, 3, 0, 2 })));
+		// Radix sort, parallel merge sort and top-k against std::stable_sort
+		std::vector<std::pair<long long, double>> orderByLargeList(200'000);
+		for (size_t i = 0; i < orderByLargeList.size(); i++)
+			orderByLargeList[i] = { static_cast<long long>((i * 2654435761u) % 1000) - 500, static_cast<double>((i * 40503u) % 977) };
+		auto orderByReference = orderByLargeList;
+		std::stable_sort(std::begin(orderByReference), std::end(orderByReference),
+			[](const auto& x, const auto& y) { return x.first > y.first || (x.first == y.first && x.second < y.second); });
+		Enumerable orderByLargeEnum(orderByLargeList);
+		auto orderByRadix = orderByLargeEnum.OrderByDescending([](const auto& x) { return x.first; })
+			.ThenBy([](const auto& x) { return static_cast<int>(x.second); });
+		auto orderByMerge = orderByLargeEnum.OrderByDescending([](const auto& x) { return x.first; })
+			.ThenBy([](const auto& x) { return x.second; });
+		assert(orderByRadix.ToVector() == orderByReference);
+		assert(orderByMerge.ToVector() == orderByReference);
+		assert(orderByMerge.Take(100).SequenceEqual(Enumerable(orderByReference).Take(100)));
+		assert(orderByMerge.First() == orderByReference.front() && orderByMerge.Last() == orderByReference.back());
+
 		// Test Prepend()
 		auto prependable_enumerable = enumerable_list.Prepend(0);
 		assert(prependable_enumerable.Any([](int x) { return x == 0; }));
 		assert(prependable_enumerable.Count() == 5);
 
+		// Test Profile(), every operator reports what it took and passed on,
+		// what it copied and allocated, and the plan is left as composed
+		profiling::Profiler profiler(allocationStats);
+		std::vector<std::string> profileReports;
+		profiler.OnReport([&](const profiling::Report& report) { profileReports.push_back(report.ToJson()); });
+		auto profileQuery = Range(1, 10).Profile(profiler)
+			.Where([](int x) { return x % 2 == 0; })
+			.Select([](int x) { return x * x; })
+			.Reverse();
+		assert(profileQuery.ToVector() == std::vector({ 100, 64, 36, 16, 4 }));
+		const auto& profileOperators = profiler.LastReport().operators;
+		std::vector<std::string> profileNames;
+		for (const auto& x : profileOperators)
+			profileNames.push_back(x.name);
+		assert(profileNames == std::vector<std::string>({ "Range(1, 10)", "Where", "Select", "Reverse", "ToVector" }));
+		assert(profileOperators[0].elementsOut == 10 && profileOperators[1].elementsIn == 10 && profileOperators[1].elementsOut == 5);
+		assert(profileOperators[3].elementsIn == 5 && profileOperators[3].bytesCopied == 5 * sizeof(int) && profileOperators[3].allocations > 0);
+		assert(profileOperators[4].elementsIn == 5 && profileOperators[4].bytesCopied == 5 * sizeof(int));
+		assert(profileOperators[1].allocations == 0 && profileOperators[2].allocations == 0 && profileOperators[2].bytesCopied == 0);
+		assert(profileReports.size() == 1 && profileReports[0].find("{\"name\": \"Where\", \"elements_in\": 10, \"elements_out\": 5,") != std::string::npos);
+		auto profileTaken = Range(1, 100).Profile(profiler).Where([](int x) { return x > 10; }).Take(2);
+		assert(profileTaken.Count() == 2 && profileReports.size() == 2);
+		assert(profiler.LastReport().operators[0].elementsOut == profiler.LastReport().operators[1].elementsIn);
+		assert(profiler.LastReport().operators[2].elementsOut == 2 && profiler.LastReport().operators[3].name == "Count");
+		assert(enumerable_list.AsLazy().Profile(profiler).Where([](int x) { return x > 1; }).Where([](int x) { return x < 4; })
+			.Explain() == "Source(4) -> Where -> Where");
+		assert(Range(1, 2).Profile(profiler).Concat(Range(3, 2).Profile(profiler)).Sum() == 10);
+		profileNames.clear();
+		for (const auto& x : profiler.LastReport().operators)
+			profileNames.push_back(x.name);
+		assert(profileNames == std::vector<std::string>({ "Range(1, 2)", "Range(3, 2)", "Concat", "Sum" }));
+		assert(profiler.LastReport().operators[2].elementsIn == 4);
+		auto profileEmptyThrew = false;
+		try { enumerable_empty.AsLazy().Profile(profiler).Select([](int x) { return x; }).First(); }
+		catch (const std::runtime_error&) { profileEmptyThrew = true; }
+		assert(profileEmptyThrew && profiler.LastReport().operators.back().name == "First");
+		assert(profileReports.size() == 4);
+
 		// Test Range()
 		std::array rangeTestList{ 1, 2, 3, 4, 5 };
 		Enumerable rangeTestEnum(rangeTestList);
 		assert(rangeTestEnum.SequenceEqual(Enumerable<int>::Range(1, 5)));
+		assert(rangeTestEnum.Skip(2).SequenceEqual(Enumerable<int>::Range(3, 3)));
 
 		// Test Repeat()
 		std::array repeatTestList{ 0, 0, 0 };
 		Enumerable repeatTestEnum(repeatTestList);
 		assert(repeatTestEnum.SequenceEqual(Enumerable<int>::Repeat(0, 3)));
 
+		// Test the streaming sources, generated ones must not allocate at all
+		auto streamingAllocations = allocationStats().count;
+		assert(Range(1, 100).Where([](int x) { return x % 2 == 0; }).Select([](int x) { return x * x; })
+			.Aggregate(0, [](int sum, int x) { return sum + x; }) == 171'700);
+		assert(Repeat(7, 3).Count() == 3 && Repeat(7, 3).All([](int x) { return x == 7; }));
+		auto generateState = 1;
+		assert(Generate([&] { return generateState *= 2; }).Take(10).Count() == 10);
+		assert(Generate([n = 0]() mutable { return n++; }).Skip(5).First() == 5);
+		assert(allocationStats().count == streamingAllocations);
+		assert(Range(1, 5).ToEnumerable().SequenceEqual(rangeTestEnum));
+
+		// Test ReadLines() and ReadRecords(), with chunks smaller than a line
+		// and than the file so lines and records straddle chunk boundaries
+		auto streamingPath = (std::filesystem::temp_directory_path() / "lmslib_streaming_test").string();
+		{
+			std::ofstream streamingFile(streamingPath, std::ios::binary);
+			streamingFile << "the quick brown fox\r\njumps\n\nover the lazy dog";
+		}
+		std::array<std::string, 4> readLinesCompList{ "the quick brown fox", "jumps", "", "over the lazy dog" };
+		assert(ReadLines(streamingPath, 4).ToEnumerable().SequenceEqual(Enumerable(readLinesCompList)));
+		assert(ReadLines(streamingPath).Where([](const std::string& x) { return x.size() > 5; }).Count() == 2);
+		{
+			std::ofstream streamingFile(streamingPath, std::ios::binary);
+			for (int i = 0; i < 10'000; i++)
+				streamingFile << "line " << i << "\n";
+		}
+		streamingAllocations = allocationStats().count;
+		assert(ReadLines(streamingPath, 1024).Select([](const std::string& x) { return int(x.size()); })
+			.Aggregate(0, [](int sum, int x) { return sum + x; }) == 88'890);
+		// The file stream, the chunk buffer and a few reallocations of the line
+		assert(allocationStats().count - streamingAllocations < 20);
+		struct StreamingRecord
+		{
+			int id;
+			double value;
+		};
+		{
+			std::ofstream streamingFile(streamingPath, std::ios::binary);
+			for (int i = 0; i < 10; i++)
+			{
+				StreamingRecord record{ i, i * 0.5 };
+				streamingFile.write(reinterpret_cast<const char*>(&record), sizeof(record));
+			}
+		}
+		auto readRecordsTest = ReadRecords<StreamingRecord>(streamingPath, 3);
+		assert(readRecordsTest.Count() == 10);
+		assert(readRecordsTest.Select([](const StreamingRecord& x) { return x.value; }).Sum() == 22.5);
+		{
+			std::ofstream streamingFile(streamingPath, std::ios::binary | std::ios::app);
+			streamingFile.put('x');
+		}
+		auto readRecordsThrew = false;
+		try { readRecordsTest.Count(); }
+		catch (const std::runtime_error&) { readRecordsThrew = true; }
+		assert(readRecordsThrew);
+		std::filesystem::remove(streamingPath);
+
 		// Test Reverse()
 		std::array reverseTestList{ 4, 3, 2, 1 };
 		Enumerable reverseTestEnum(reverseTestList);
 		assert(enumerable_list.Reverse().SequenceEqual(reverseTestEnum));
+		assert(Enumerable<int>(enumerable_list.ToVector()).Reverse().SequenceEqual(reverseTestEnum));
+		assert(enumerable_list.AsLazy().Reverse().ToEnumerable().SequenceEqual(reverseTestEnum));
+		assert(enumerable_list.AsLazy().Where([](int x) { return x > 1; }).Reverse().First() == 4);
+
+		// Test RollingMax(), RollingMin() and RollingSum() against recomputing
+		// every window
+		std::vector<int> rollingSource;
+		for (int i = 0; i < 200; i++)
+			rollingSource.push_back((i * 7919) % 61 - 30 + (i % 13 == 0 ? 0 : i / 20));
+		auto rollingEnum = Enumerable<int>::View(rollingSource);
+		for (int window : { 1, 2, 5, 17, 200 })
+		{
+			auto rollingMax = rollingEnum.RollingMax(window);
+			auto rollingMin = rollingEnum.RollingMin(window);
+			auto rollingSum = rollingEnum.RollingSum(window);
+			assert(rollingMax.Count() == 200 - window + 1 && rollingSum.Count() == rollingMax.Count());
+			for (int i = 0; i + window <= 200; i++)
+			{
+				auto first = rollingSource.begin() + i;
+				assert(rollingMax.ElementAt(i) == *std::max_element(first, first + window));
+				assert(rollingMin.ElementAt(i) == *std::min_element(first, first + window));
+				assert(rollingSum.ElementAt(i) == std::accumulate(first, first + window, 0));
+			}
+		}
+		assert(!enumerable_list.RollingMax(5).Any());
+		assert(enumerable_sentence.RollingMin(3).SequenceEqual(
+			Enumerable(std::array<std::string, 7>{ "brown", "brown", "brown", "fox", "jumps", "lazy", "dog" })
+		));
+
+		// Test that Select() and Where() pass strings by reference and reuse
+		// the buffers of temporaries instead of copying elements. Debug
+		// iterator proxies may add a few allocations per container, but never
+		// one per element.
+		constexpr int copyTestCount = 100;
+		std::vector<std::string> copyTestVec;
+		for (int i = 0; i < copyTestCount; i++)
+			copyTestVec.push_back(std::string(i % 2 == 0 ? "even" : "odd") + " element, too long for the small string buffer");
+		Enumerable copyTestEnum(copyTestVec);
+		auto copyAllocations = allocationStats().count;
+		auto copySelected = copyTestEnum.Select([](const std::string& x) { return x.size(); });
+		assert(allocationStats().count - copyAllocations < copyTestCount / 10);
+		copyAllocations = allocationStats().count;
+		auto copyFiltered = Enumerable<std::string>(std::move(copyTestVec))
+			.Select([](const std::string& x) { return x.substr(0, 3); })
+			.Where([](const std::string& x) { return x == "eve"; });
+		assert(allocationStats().count - copyAllocations < copyTestCount / 10);
+		assert(copySelected.Count() == copyTestCount && copyFiltered.Count() == copyTestCount / 2);
 
 		// Test SequenceEqual()
 		std::array equalTestList = { 1, 2, 3 };
@@ -148,6 +776,7 @@ namespace linq
 		assert(!enumerable_list.SequenceEqual(equalTestEnum));
 		equalTestEnum = equalTestEnum.Append(4);
 		assert(enumerable_list.SequenceEqual(equalTestEnum));
+		assert(!enumerable_list.SequenceEqual(reverseTestEnum));
 
 		// Test Single()
 		std::array singleTestList{ 1 };
@@ -176,8 +805,127 @@ namespace linq
 			skipWhileTestEnum.SkipWhile([](int x, int i) { return i < 2; })
 		));
 
+		// Test SlidingWindow()
+		auto windowTestEnum = enumerable_list.SlidingWindow(3);
+		assert(windowTestEnum.Count() == 2);
+		assert(windowTestEnum.Last().SequenceEqual(Enumerable(std::array{ 2, 3, 4 })));
+		assert(!enumerable_list.SlidingWindow(5).Any());
+		auto windowViews = Enumerable<int>::View(rollingSource).SlidingWindow(50);
+		rollingSource[199] = 1000;
+		assert(windowViews.Count() == 151 && windowViews.Last().Max() == 1000);
+
+		// Test that results of up to InlineCapacity elements stay off the heap,
+		// and that longer ones spill over intact
+		auto smallAllocations = allocationStats().count;
+		auto smallTestEnum = enumerable_list.Where([](int x) { return x > 1; }).Select([](int x) { return x * 10; });
+		smallTestEnum = std::move(smallTestEnum).Prepend(0).Append(50).Reverse();
+		assert(smallTestEnum.SequenceEqual(Enumerable(std::array{ 50, 40, 30, 20, 0 })));
+		assert(enumerable_list.Concat(enumerable_list).Skip(2).Count() == 6);
+		assert(allocationStats().count == smallAllocations);
+		auto spillTestEnum = Enumerable<int>::Range(0, 10);
+		auto spilledEnum = spillTestEnum.Concat(spillTestEnum).Prepend(-1);
+		assert(spilledEnum.Count() == 21 && spilledEnum.First() == -1 && spilledEnum.ElementAt(11) == 0 && spilledEnum.Last() == 9);
+		auto movedSpilledEnum = std::move(spilledEnum).Where([](int x) { return x % 2 == 0; });
+		assert(movedSpilledEnum.SequenceEqual(Enumerable(std::array{ 0, 2, 4, 6, 8, 0, 2, 4, 6, 8 })));
+		std::array<std::string, 3> smallStrings{ std::string(40, 'a'), std::string(40, 'b'), std::string(40, 'c') };
+		auto smallStringEnum = Enumerable(smallStrings).Concat(Enumerable(smallStrings));
+		auto smallStringCopy = smallStringEnum;
+		smallStringEnum = std::move(smallStringCopy).Reverse();
+		assert(smallStringEnum.First() == smallStrings[2] && smallStringEnum.Count() == 6);
+
 		// Test Sum()
 		assert(enumerable_list.Sum() == 10);
+		assert(enumerable_list.SumAndCount() == std::pair(10LL, 4));
+		assert(Enumerable(std::array{ INT_MAX, 1 }).SumAndCount() == std::pair(INT_MAX + 1LL, 2));
+
+		// Test the vectorized Sum() and MinMax() kernels against the scalar ones,
+		// with lengths that leave a scalar tail
+		for (int size = 1; size < 80; size += 7)
+		{
+			std::vector<int> simdInts(size);
+			std::vector<long long> simdLongs(size);
+			std::vector<double> simdDoubles(size);
+			std::vector<float> simdFloats(size);
+			for (int i = 0; i < size; i++)
+			{
+				simdInts[i] = (i * 37) % 23 - 11;
+				simdLongs[i] = (i * 37LL) % 23 * 10'000'000'000LL;
+				simdDoubles[i] = simdFloats[i] = static_cast<float>(i % 5) * 0.25f - 0.5f;
+			}
+			for (auto level : { simd::Level::Scalar, simd::Level::SSE2, simd::Level::AVX2 })
+			{
+				if (level > simd::level())
+					continue;
+				assert(simd::Sum<int>(simdInts, level) == simd::Sum<int>(simdInts, simd::Level::Scalar));
+				assert(simd::Sum<long long>(simdLongs, level) == simd::Sum<long long>(simdLongs, simd::Level::Scalar));
+				assert(simd::Sum<double>(simdDoubles, level) == simd::Sum<double>(simdDoubles, simd::Level::Scalar));
+				assert(simd::Sum<float>(simdFloats, level) == simd::Sum<float>(simdFloats, simd::Level::Scalar));
+				assert(simd::MinMax<int>(simdInts, level) == simd::MinMax<int>(simdInts, simd::Level::Scalar));
+				assert(simd::MinMax<long long>(simdLongs, level) == simd::MinMax<long long>(simdLongs, simd::Level::Scalar));
+				assert(simd::MinMax<double>(simdDoubles, level) == simd::MinMax<double>(simdDoubles, simd::Level::Scalar));
+				assert(simd::MinMax<float>(simdFloats, level) == simd::MinMax<float>(simdFloats, simd::Level::Scalar));
+			}
+		}
+
+		// Test Sum<T_Sum>(), the summations and Average() against long double
+		// references, on ints whose sum overflows an int and on floats that
+		// a float sum over one accumulator gets wrong in the third digit
+		std::vector<int> wideInts(100'000, 2'000'000'000);
+		wideInts[1] = -2'000'000'000;
+		long long wideIntsSum = std::accumulate(std::begin(wideInts), std::end(wideInts), 0LL);
+		auto wideIntEnum = Enumerable<int>::View(wideInts);
+		assert(wideIntEnum.Sum<long long>() == wideIntsSum && wideIntEnum.Sum<int64_t>() == wideIntsSum);
+		assert(wideIntEnum.AsLazy().Sum<long long>() == wideIntsSum);
+		assert(wideIntEnum.AsParallel().Sum<long long>() == wideIntsSum);
+		assert(wideIntEnum.Average<double>() == wideIntsSum / 100'000.0);
+		assert(wideIntEnum.AsLazy().Average<double>() == wideIntsSum / 100'000.0);
+		assert(wideIntEnum.AsParallel().Average<double>() == wideIntsSum / 100'000.0);
+		assert(enumerable_empty.Average() == 0 && enumerable_empty.AsLazy().Average() == 0);
+		std::array wrappingInts{ INT_MAX, 1 };
+		Enumerable wrappingEnum(wrappingInts);
+		assert(wrappingEnum.Sum() == INT_MIN && wrappingEnum.AsLazy().Sum() == INT_MIN && wrappingEnum.AsParallel().Sum() == INT_MIN);
+
+		std::vector<float> wideFloats(1 << 20);
+		long double wideFloatsSum = 0;
+		for (size_t i = 0; i < wideFloats.size(); i++)
+		{
+			wideFloats[i] = static_cast<float>(i % 1000) * 0.001f + (i % 7 == 0 ? 1000.0f : 0.1f);
+			wideFloatsSum += wideFloats[i];
+		}
+		auto sumError = [&](long double sum) { return std::abs(sum - wideFloatsSum) / wideFloatsSum; };
+		auto wideFloatEnum = Enumerable<float>::View(wideFloats);
+		float wideFloatsNaive = 0;
+		for (auto x : wideFloats)
+			wideFloatsNaive += x;
+		assert(sumError(wideFloatsNaive) > 1e-3);
+		for (auto level : { simd::Level::Scalar, simd::Level::SSE2, simd::Level::AVX2 })
+		{
+			if (level > simd::level())
+				continue;
+			assert(sumError(simd::Accumulate<float, float>(wideFloats, Summation::Compensated, level)) < 1e-7);
+			assert(sumError(simd::Accumulate<float, float>(wideFloats, Summation::Pairwise, level)) < 1e-7);
+			assert(sumError(simd::Accumulate<double, float>(wideFloats, Summation::Naive, level)) < 1e-12);
+			assert(sumError(simd::Accumulate<double, float>(wideFloats, Summation::Compensated, level)) < 1e-15);
+			assert(sumError(simd::Accumulate<double, float>(wideFloats, Summation::Pairwise, level)) < 1e-15);
+		}
+		assert(sumError(wideFloatEnum.Sum(Summation::Compensated)) < 1e-7);
+		assert(sumError(wideFloatEnum.AsLazy().Sum(Summation::Compensated)) < 1e-7);
+		assert(sumError(wideFloatEnum.AsLazy().Sum(Summation::Pairwise)) < 1e-7);
+		assert(sumError(wideFloatEnum.AsParallel().Sum(Summation::Compensated)) < 1e-7);
+		assert(sumError(wideFloatEnum.AsParallel().Sum(Summation::Pairwise)) < 1e-7);
+		assert(sumError(wideFloatEnum.AsLazy().Sum<double>()) < 1e-12);
+		assert(std::abs(wideFloatEnum.Average<double>() - wideFloatsSum / wideFloats.size()) < 1e-9);
+
+		// Compensation keeps what cancelling large elements would round off,
+		// in every lane
+		std::vector<double> cancelling;
+		for (int i = 0; i < 1000; i++)
+			cancelling.insert(std::end(cancelling), { 1e100, 1.0, -1e100 });
+		for (auto level : { simd::Level::Scalar, simd::Level::SSE2, simd::Level::AVX2 })
+			if (level <= simd::level())
+				assert((simd::Accumulate<double, double>(cancelling, Summation::Compensated, level) == 1000));
+		auto cancellingEnum = Enumerable<double>::View(cancelling);
+		assert(cancellingEnum.AsLazy().Sum(Summation::Compensated) == 1000 && cancellingEnum.AsLazy().Sum() != 1000);
 
 		// Tests Take()
 		std::array takeTestList{ 1, 2, 3 };
@@ -201,12 +949,113 @@ namespace linq
 			takeWhileTestEnum.TakeWhile([](int x, int i) {return i < 4; })
 		));
 
+		// Test ToDictionary()
+		auto toDictionaryTest = enumerable_list.ToDictionary([](int x) { return x * 10; }, [](int x) { return x % 2 == 0; });
+		assert(toDictionaryTest.size() == 4 && toDictionaryTest.at(20) && !toDictionaryTest.at(30));
+		auto toDictionaryThrew = false;
+		try { enumerable_sentence.ToDictionary([](const std::string& x) { return x; }); }
+		catch (const std::invalid_argument&) { toDictionaryThrew = true; }
+		assert(toDictionaryThrew);
+
+		// Test ToFile() and MappedTable, block statistics must only skip
+		// blocks without matches
+		auto tablePath = (std::filesystem::temp_directory_path() / "lmslib_table_test").string();
+		std::vector<Event> tableTestList(100'000);
+		for (size_t i = 0; i < tableTestList.size(); i++)
+			tableTestList[i] = { static_cast<long long>(i) * 10, static_cast<int>((i * 7919) % 1000), static_cast<float>(i % 100) };
+		Enumerable(tableTestList).ToFile(tablePath, &Event::timestamp, &Event::value);
+		{
+			MappedTable<Event> table(tablePath);
+			// Zero-copy, viewing the records allocates next to nothing
+			auto tableBytes = allocationStats().bytes;
+			assert(table.Count() == 100'000);
+			assert(table.AsEnumerable().Last().timestamp == 999'990);
+			assert(allocationStats().bytes - tableBytes < 1024);
+			assert(table.BlockCount() == 25);
+			assert(table.CandidateBlocks(&Event::timestamp, 50'000LL, 90'000LL).size() <= 2);
+			assert(table.CandidateBlocks(&Event::timestamp, -10LL, -1LL).size() == 0);
+			assert(table.CandidateBlocks(&Event::user, 0, 10).size() == table.BlockCount());
+			assert(table.WhereBetween(&Event::timestamp, 50'000LL, 90'000LL).Count() == 4001);
+			assert(table.WhereBetween(&Event::value, 98.5f, 200.0f).Count() == 1000);
+			assert(table.WhereBetween(&Event::user, 0, 9).Count()
+				== Enumerable(tableTestList).Where([](const Event& x) { return x.user <= 9; }).Count());
+		}
+		Enumerable<int>::Range(0, 10'000).ToFile(tablePath);
+		{
+			MappedTable<int> table(tablePath);
+			assert(table.AsEnumerable().SequenceEqual(Enumerable<int>::Range(0, 10'000)));
+			assert(table.CandidateBlocks(5000, 5001).size() == 1);
+			assert(table.WhereBetween(5000, 5001).Sum() == 10'001);
+		}
+		auto tableThrew = false;
+		try { MappedTable<Event> table(tablePath); }
+		catch (const std::runtime_error&) { tableThrew = true; }
+		assert(tableThrew);
+		// Without columns there are no statistics and every block is a candidate
+		Enumerable(tableTestList).ToFile(tablePath);
+		{
+			MappedTable<Event> table(tablePath);
+			assert(table.Count() == 100'000 && table.CandidateBlocks(&Event::timestamp, -10LL, -1LL).size() == table.BlockCount());
+			assert(table.WhereBetween(&Event::timestamp, 50'000LL, 90'000LL).Count() == 4001);
+		}
+		// Headers whose sizes wrap around 64 bits must not pass for ones
+		// that fit in the file, dropping the columns only drops the statistics
+		for (auto [field, value, valid] : { std::tuple(offsetof(detail::TableHeader, count), (1ULL << 62) + 1, false),
+			std::tuple(offsetof(detail::TableHeader, statsOffset), ~0ULL - 15, false),
+			std::tuple(offsetof(detail::TableHeader, columns), 1ULL << 61, false),
+			std::tuple(offsetof(detail::TableHeader, columns), 0ULL, true) })
+		{
+			Enumerable<int>::Range(0, 10'000).ToFile(tablePath);
+			{
+				std::fstream tableFile(tablePath, std::ios::in | std::ios::out | std::ios::binary);
+				tableFile.seekp(std::streamoff(field));
+				tableFile.write(reinterpret_cast<const char*>(&value), sizeof(value));
+			}
+			tableThrew = false;
+			try
+			{
+				MappedTable<int> table(tablePath);
+				assert(table.CandidateBlocks(5000, 5001).size() == table.BlockCount());
+			}
+			catch (const std::runtime_error&) { tableThrew = true; }
+			assert(tableThrew != valid);
+		}
+		std::filesystem::remove(tablePath);
+
+		// Test ToLookup(), with enough keys to grow the hash table several times
+		std::vector<int> lookupTestList(10'000);
+		std::iota(std::begin(lookupTestList), std::end(lookupTestList), 0);
+		auto lookupTest = Enumerable(lookupTestList).ToLookup([](int x) { return x % 1000; });
+		assert(lookupTest.Count() == 1000);
+		assert(lookupTest.Keys()[999] == 999);
+		assert(lookupTest[7].Count() == 10 && lookupTest[7].First() == 7 && lookupTest[7].Last() == 9007);
+		assert(lookupTest.Contains(0) && !lookupTest.Contains(1000));
+		assert(lookupTest[1000].Count() == 0);
+		auto lookupTestSum = 0;
+		lookupTest.foreach([&](int, const Enumerable<int>& group) { lookupTestSum += group.Count(); });
+		assert(lookupTestSum == 10'000);
+
 		// Test Union()
 		std::array u1TestList{ 1, 2, 1 };
 		std::array u2TestList{ 2, 3, 1, 4 };
 		Enumerable u1TestEnum(u1TestList);
 		Enumerable u2TestEnum(u2TestList);
 		assert(enumerable_list.SequenceEqual(u1TestEnum.Union(u2TestEnum)));
+		assert(ordinalDistinctEnum.SequenceEqual(ordinalEnum.Union(ordinalDistinctEnum)));
+
+		// Test View()
+		std::vector viewTestVec{ 1, 2, 3, 4 };
+		auto viewTestEnum = Enumerable<int>::View(viewTestVec);
+		auto viewSkipEnum = viewTestEnum.Skip(2);
+		viewTestVec[3] = 40;
+		assert(viewTestEnum.Last() == 40);
+		assert(viewSkipEnum.Sum() == 43);
+		assert(viewTestEnum.ToVector() == viewTestVec);
+		assert(Enumerable<int>::View(std::span<const int>(viewTestVec).subspan(1, 2)).Sum() == 5);
+		assert(Enumerable<int>::View(viewTestVec.begin() + 1, viewTestVec.end()).Count() == 3);
+		assert(View(viewTestVec).Where([](int x) { return x > 2; }).Count() == 2);
+		std::list viewTestLinked{ 1, 2, 3 };
+		assert(View(viewTestLinked).Where([](int x) { return x > 1; }).Sum() == 5);
 
 		// Test Zip
 		std::array zip1List{ 1, 2, 3 };
@@ -235,10 +1084,6 @@ namespace linq
 			)
 		));
 
-		// End time measurement
-		end = s_clock::now();
-
-		std::cout << "All tests passed successfully!" << std::endl
-			<< "This took " << std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() << " microseconds." << std::endl;
+		std::cout << "All tests passed successfully!" << std::endl;
 	}
 }  // namespace linq